@@ -0,0 +1,114 @@
+#include "CombineSession.h"
+#include <algorithm>
+#include "exception/located_exception.h"
+
+using safeheron::bignum::BN;
+using safeheron::exception::LocatedException;
+
+namespace safeheron {
+namespace tss_rsa{
+
+CombineSession::CombineSession(const Combiner &combiner, const std::string &doc)
+        : combiner_(combiner),
+          doc_(doc),
+          jacobi_m_n_(0),
+          partial_num_(0),
+          complete_(false) {
+    x_ = combiner_.PrepareMessage(BN::FromBytesBE(doc_), jacobi_m_n_);
+}
+
+CombineSession::CombineSession(const Combiner &combiner, const std::string &doc, const std::vector<int> &expected_index_arr)
+        : CombineSession(combiner, doc) {
+    std::vector<int> index_arr = expected_index_arr;
+    std::sort(index_arr.begin(), index_arr.end());
+    std::vector<BN> exp_arr;
+    if(index_arr.size() != (size_t)combiner_.key_meta().k() || !combiner_.GetLagrangeExponents(index_arr, exp_arr)){
+        throw LocatedException(__FILE__, __LINE__, __FUNCTION__, -1, "expected_index_arr is not a valid signer set of k parties.");
+    }
+    expected_index_arr_ = index_arr;
+    for(const auto &exp : exp_arr){
+        expected_exp_arr_.push_back(exp * combiner_.a_);
+    }
+    // y = x^b \prod x_i^{2a\lambda_{0,i}^S}, the factor x^b is known now.
+    partial_sig_ = combiner_.mont_n_.PowM(x_, combiner_.b_);
+}
+
+bool CombineSession::AddShare(const RSASigShare &sig_share) {
+    const int index = sig_share.index();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if(complete_ || index < 1 || index > combiner_.key_meta().l()) return false;
+        if(!seen_index_set_.insert(index).second) return false;
+    }
+
+    // Validate the share, and compute its term if it belongs to S, out of the lock.
+    std::vector<RSASigShare> sig_arr = {sig_share};
+    std::vector<std::vector<size_t>> invalid_arr_arr;
+    bool ok = false;
+    BN term;
+    bool has_term = false;
+    try {
+        ok = combiner_.InternalVerifySigShares({x_}, {&sig_arr}, invalid_arr_arr);
+        auto iter = std::lower_bound(expected_index_arr_.begin(), expected_index_arr_.end(), index);
+        if(ok && iter != expected_index_arr_.end() && *iter == index){
+            term = combiner_.mont_n_.PowM(sig_share.sig_share(), expected_exp_arr_[iter - expected_index_arr_.begin()]);
+            has_term = true;
+        }
+    } catch (const LocatedException &e) {
+        ok = false;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if(!ok){
+        // The party may send its share again.
+        seen_index_set_.erase(index);
+        return false;
+    }
+    if(complete_) return false;
+    valid_arr_.push_back(sig_share);
+    if(has_term){
+        partial_sig_ = combiner_.mont_n_.MulM(partial_sig_, term);
+        partial_num_++;
+    }
+    if(valid_arr_.size() == (size_t)combiner_.key_meta().k()){
+        Finish();
+    }
+    return true;
+}
+
+void CombineSession::Finish() {
+    if(!expected_index_arr_.empty() && partial_num_ == expected_index_arr_.size()){
+        // The valid shares are exactly S.
+        sig_ = partial_sig_;
+        if(jacobi_m_n_ == -1){
+            sig_ = combiner_.mont_n_.MulM(sig_, combiner_.vku_inv_);
+        }
+        complete_ = true;
+    }else{
+        complete_ = combiner_.CombinePreparedMessage(x_, jacobi_m_n_, valid_arr_, sig_);
+    }
+}
+
+bool CombineSession::IsComplete() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return complete_;
+}
+
+bool CombineSession::GetSignature(safeheron::bignum::BN &out_sig) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if(!complete_) return false;
+    out_sig = sig_;
+    return true;
+}
+
+std::vector<int> CombineSession::GetValidIndexes() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<int> index_arr;
+    for(const auto &sig_share : valid_arr_){
+        index_arr.push_back(sig_share.index());
+    }
+    return index_arr;
+}
+
+};
+};
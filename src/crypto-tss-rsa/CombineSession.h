@@ -0,0 +1,99 @@
+#ifndef SAFEHERON_TSS_RSA_COMBINE_SESSION_H
+#define SAFEHERON_TSS_RSA_COMBINE_SESSION_H
+
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+#include "crypto-bn/bn.h"
+#include "Combiner.h"
+#include "RSASigShare.h"
+
+namespace safeheron {
+namespace tss_rsa{
+
+/**
+ * Incremental combination of the shares of signature of one document, as they arrive.
+ *
+ * Each share is validated by "AddShare" as soon as it lands, and the signature is made right
+ * after the k-th valid share. With an expected signer set S of k parties, the exponents
+ * $$2a\lambda_{0,i}^S$$ are known beforehand, so the term x_i^{2a\lambda_{0,i}^S} of a share of S
+ * is also computed on arrival and multiplied into the partial signature; the k-th share then only
+ * costs its proof and its own term. If the valid shares end up not being S, the k valid shares are
+ * combined at once as "Combiner" does.
+ *
+ * "AddShare" may be called from many threads, the proofs and the terms of different shares are
+ * computed in parallel. The combiner must outlive the session.
+ */
+class CombineSession{
+public:
+    /**
+     * Constructor, without an expected signer set.
+     * @param[in] combiner combiner of the key.
+     * @param[in] doc document.
+     */
+    CombineSession(const Combiner &combiner, const std::string &doc);
+
+    /**
+     * Constructor, with an expected signer set.
+     * @param[in] combiner combiner of the key.
+     * @param[in] doc document.
+     * @param[in] expected_index_arr expected signer set S: k distinct indexes in (1, ... ,l).
+     * @throws LocatedException if S is not a valid signer set of k parties.
+     */
+    CombineSession(const Combiner &combiner, const std::string &doc, const std::vector<int> &expected_index_arr);
+
+    /**
+     * Validate a share of signature and add it.
+     * @param[in] sig_share share of signature.
+     * @return true if the share is valid and added, false if it's invalid, if its party already
+     *         sent a share, or if the signature is already made.
+     */
+    bool AddShare(const RSASigShare &sig_share);
+
+    /**
+     * @return true if the signature is made.
+     */
+    bool IsComplete() const;
+
+    /**
+     * Get the signature.
+     * @param[out] out_sig a real signature.
+     * @return true if the signature is made, false otherwise.
+     */
+    bool GetSignature(safeheron::bignum::BN &out_sig) const;
+
+    /**
+     * Get the indexes of the parties whose valid shares were added, in the order of arrival.
+     */
+    std::vector<int> GetValidIndexes() const;
+
+private:
+    CombineSession(const CombineSession &other);
+    CombineSession &operator=(const CombineSession &other);
+
+    /**
+     * Make the signature from the k valid shares, with mutex_ held.
+     */
+    void Finish();
+
+private:
+    const Combiner &combiner_;  /**< combiner of the key */
+    std::string doc_;  /**< document */
+    safeheron::bignum::BN x_;  /**< prepared message */
+    int jacobi_m_n_;  /**< Jacobi symbol of the message */
+    std::vector<int> expected_index_arr_;  /**< expected signer set S, sorted, empty if none */
+    std::vector<safeheron::bignum::BN> expected_exp_arr_;  /**< 2a\lambda_{0,i}^S of the parties of S */
+    mutable std::mutex mutex_;  /**< guards the members below */
+    std::set<int> seen_index_set_;  /**< parties whose share is added or being validated */
+    std::vector<RSASigShare> valid_arr_;  /**< valid shares, in the order of arrival */
+    safeheron::bignum::BN partial_sig_;  /**< x^b times the terms of the valid shares of S */
+    size_t partial_num_;  /**< number of terms in partial_sig_ */
+    bool complete_;  /**< whether the signature is made */
+    safeheron::bignum::BN sig_;  /**< the signature */
+};
+
+};
+};
+
+#endif //SAFEHERON_TSS_RSA_COMBINE_SESSION_H
@@ -0,0 +1,561 @@
+#include "Combiner.h"
+#include <algorithm>
+#include "common.h"
+#include "RSASigShareProof.h"
+#include "parallel.h"
+#include "exception/located_exception.h"
+
+using safeheron::bignum::BN;
+using safeheron::exception::LocatedException;
+
+namespace safeheron {
+namespace tss_rsa{
+
+const size_t Combiner::MAX_SUBSET_CANDIDATES;
+const size_t Combiner::MAX_CACHED_SIGNER_SETS;
+
+Combiner::Combiner(const RSAPublicKey &public_key, const RSAKeyMeta &key_meta)
+        : public_key_(public_key),
+          key_meta_(key_meta),
+          mont_n_(public_key.n()) {
+    // e' is always set to 4.
+    BN ep(4);
+
+    // Compute \Delta = l!
+    delta_ = BN(1);
+    for(int i = 1; i <= key_meta_.l(); i++){
+        delta_ *= i;
+    }
+
+    // 4a + eb = 1
+    BN d;
+    BN::ExtendedEuclidean(ep, public_key_.e(), a_, b_, d);
+
+    vku_e_ = mont_n_.PowM(key_meta_.vku(), public_key_.e());
+    vku_inv_ = key_meta_.vku().InvM(public_key_.n());
+
+    // Leave it empty on failure, the proofs will then be verified one by one.
+    if(!mont_n_.BatchInvM(key_meta_.vki_arr(), vki_inv_arr_)){
+        vki_inv_arr_.clear();
+    }
+
+    // Only use fixed-base tables built for this key.
+    std::shared_ptr<const FixedBaseTable> vkv_table = key_meta_.vkv_table();
+    use_table_ = vkv_table && vkv_table->mont_n().n() == public_key_.n() && vkv_table->base() == key_meta_.vkv()
+                 && key_meta_.vki_inv_table(key_meta_.vki_arr().size() - 1) != nullptr;
+}
+
+Combiner::Combiner(const Combiner &other)
+        : public_key_(other.public_key_),
+          key_meta_(other.key_meta_),
+          mont_n_(other.mont_n_),
+          delta_(other.delta_),
+          a_(other.a_),
+          b_(other.b_),
+          vku_e_(other.vku_e_),
+          vku_inv_(other.vku_inv_),
+          vki_inv_arr_(other.vki_inv_arr_),
+          use_table_(other.use_table_) {
+    std::lock_guard<std::mutex> lock(other.mutex_);
+    exp_cache_ = other.exp_cache_;
+    cost_cache_ = other.cost_cache_;
+}
+
+const RSAPublicKey &Combiner::public_key() const {
+    return public_key_;
+}
+
+const RSAKeyMeta &Combiner::key_meta() const {
+    return key_meta_;
+}
+
+const MontContext &Combiner::mont_n() const {
+    return mont_n_;
+}
+
+bool Combiner::IsValidSignerSet(const std::vector<int> &index_arr) const {
+    // S should be a sorted subset of (1, ... ,l) without duplicates
+    if(index_arr.empty()) return false;
+    for(size_t j = 0; j < index_arr.size(); j++){
+        if(index_arr[j] < 1 || index_arr[j] > key_meta_.l()) return false;
+        if(j > 0 && index_arr[j] <= index_arr[j-1]) return false;
+    }
+    return true;
+}
+
+void Combiner::ComputeLagrangeExponents(const std::vector<int> &index_arr,
+                                        std::vector<safeheron::bignum::BN> &exp_arr) const {
+    std::vector<BN> S;
+    for(int index : index_arr){
+        S.emplace_back(BN(index));
+    }
+
+    exp_arr.clear();
+    for(int index : index_arr){
+        BN lam = lambda(BN(0), BN(index), S, delta_);
+        exp_arr.emplace_back(lam * 2);
+    }
+}
+
+bool Combiner::GetLagrangeExponents(const std::vector<int> &index_arr,
+                                    std::vector<safeheron::bignum::BN> &exp_arr) const {
+    if(!IsValidSignerSet(index_arr)) return false;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto iter = exp_cache_.find(index_arr);
+        if(iter != exp_cache_.end()){
+            exp_arr = iter->second;
+            return true;
+        }
+    }
+
+    ComputeLagrangeExponents(index_arr, exp_arr);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    // Another thread may have inserted S in the meantime, which does not grow the cache.
+    if(exp_cache_.size() >= MAX_CACHED_SIGNER_SETS && exp_cache_.find(index_arr) == exp_cache_.end()){
+        exp_cache_.clear();
+    }
+    exp_cache_[index_arr] = exp_arr;
+    return true;
+}
+
+bool Combiner::GetSubsetCost(const std::vector<int> &index_arr, size_t &cost) const {
+    if(!IsValidSignerSet(index_arr)) return false;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto iter = cost_cache_.find(index_arr);
+        if(iter != cost_cache_.end()){
+            cost = iter->second;
+            return true;
+        }
+    }
+
+    // Only the picked signer set is combined, so the exponents of the others are not kept.
+    std::vector<BN> exp_arr;
+    ComputeLagrangeExponents(index_arr, exp_arr);
+    // The combination raises the shares to 2a\lambda_{0,i}^S, see "CombinePreparedMessage".
+    cost = 0;
+    for(const auto &exp : exp_arr){
+        cost += (exp * a_).BitLength();
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if(cost_cache_.size() >= MAX_CACHED_SIGNER_SETS && cost_cache_.find(index_arr) == cost_cache_.end()){
+        cost_cache_.clear();
+    }
+    cost_cache_[index_arr] = cost;
+    return true;
+}
+
+BN Combiner::PrepareMessage(const safeheron::bignum::BN &_x, int &jacobi_m_n) const {
+    // x = m    , if (m, n) == 1
+    // x = m*u^e, if (m, n) == -1
+    BN x = _x;
+    jacobi_m_n = BN::JacobiSymbol(x, public_key_.n());
+    if( jacobi_m_n == -1){
+        x = mont_n_.MulM(x, vku_e_);
+    }
+    return x;
+}
+
+bool Combiner::InternalVerifySigShares(const std::vector<safeheron::bignum::BN> &x_arr,
+                                       const std::vector<const std::vector<RSASigShare> *> &sig_arr_arr,
+                                       std::vector<std::vector<size_t>> &invalid_arr_arr) const {
+    const BN &v = key_meta_.vkv();
+    invalid_arr_arr.assign(x_arr.size(), std::vector<size_t>());
+
+    // Verify the proof of one share alone.
+    auto verify_one = [&](size_t d, size_t pos) {
+        const RSASigShare &sig = (*sig_arr_arr[d])[pos];
+        RSASigShareProof proof(sig.z(), sig.c());
+        bool ok = false;
+        try {
+            if(use_table_){
+                ok = proof.Verify(*key_meta_.vkv_table(), *key_meta_.vki_inv_table(sig.index() - 1),
+                                  key_meta_.vki(sig.index() - 1), x_arr[d], sig.sig_share());
+            }else{
+                ok = proof.Verify(v, key_meta_.vki(sig.index() - 1), x_arr[d], mont_n_, sig.sig_share());
+            }
+        } catch (const LocatedException &e) {
+            ok = false;
+        }
+        if(!ok) invalid_arr_arr[d].push_back(pos);
+    };
+
+    // Collect the shares which could be verified in batch.
+    struct Item {
+        size_t d;
+        size_t pos;
+    };
+    std::vector<Item> item_arr;
+    std::vector<BN> sig_share_arr;
+    for(size_t d = 0; d < x_arr.size(); d++){
+        const std::vector<RSASigShare> &sig_arr = *sig_arr_arr[d];
+        for(size_t pos = 0; pos < sig_arr.size(); pos++){
+            const RSASigShare &sig = sig_arr[pos];
+            if(sig.index() < 1 || sig.index() > key_meta_.l() || (size_t)sig.index() > key_meta_.vki_arr().size()){
+                invalid_arr_arr[d].push_back(pos);
+            }else if(sig.z().IsNeg() || sig.c().IsNeg() || vki_inv_arr_.empty()){
+                verify_one(d, pos);
+            }else{
+                item_arr.push_back({d, pos});
+                sig_share_arr.push_back(sig.sig_share());
+            }
+        }
+    }
+
+    std::vector<BN> sig_inv_arr;
+    if(!mont_n_.BatchInvM(sig_share_arr, sig_inv_arr)){
+        // Some share is not invertible, find it one by one.
+        for(const auto &item : item_arr){
+            verify_one(item.d, item.pos);
+        }
+        item_arr.clear();
+    }
+
+    if(!item_arr.empty()) {
+        // v^z for all the shares
+        std::vector<BN> z_arr;
+        for (const auto &item: item_arr) {
+            z_arr.push_back((*sig_arr_arr[item.d])[item.pos].z());
+        }
+        std::vector<BN> vz_arr;
+        if(use_table_){
+            for(const auto &z : z_arr){
+                vz_arr.push_back(key_meta_.vkv_table()->PowM(z));
+            }
+        }else{
+            vz_arr = mont_n_.BatchPowM(v, z_arr);
+        }
+
+        // x_tilde^z for the shares of each document
+        std::vector<BN> x_tilde_arr;
+        std::vector<BN> xz_arr(item_arr.size());
+        for (size_t d = 0; d < x_arr.size(); d++) {
+            x_tilde_arr.push_back(mont_n_.PowM(x_arr[d], BN::FOUR));
+            std::vector<size_t> j_arr;
+            std::vector<BN> t_z_arr;
+            for (size_t j = 0; j < item_arr.size(); j++) {
+                if (item_arr[j].d != d) continue;
+                j_arr.push_back(j);
+                t_z_arr.push_back(z_arr[j]);
+            }
+            if (j_arr.empty()) continue;
+            std::vector<BN> t_xz_arr = mont_n_.BatchPowM(x_tilde_arr[d], t_z_arr);
+            for (size_t t = 0; t < j_arr.size(); t++) {
+                xz_arr[j_arr[t]] = t_xz_arr[t];
+            }
+        }
+
+        for (size_t j = 0; j < item_arr.size(); j++) {
+            const RSASigShare &sig = (*sig_arr_arr[item_arr[j].d])[item_arr[j].pos];
+            const BN &vi = key_meta_.vki(sig.index() - 1);
+            // v' = v^z * vi^(-c)  mod n
+            BN vic = use_table_ ? key_meta_.vki_inv_table(sig.index() - 1)->PowM(sig.c())
+                                : mont_n_.PowM(vki_inv_arr_[sig.index() - 1], sig.c());
+            BN vp = mont_n_.MulM(vz_arr[j], vic);
+            // x' = x_tilde^z * x^(-2c)  mod n
+            BN xp = mont_n_.MulM(xz_arr[j], mont_n_.PowM(sig_inv_arr[j], sig.c() * 2));
+            // sig^2  mod n
+            BN sig2 = mont_n_.MulM(sig.sig_share(), sig.sig_share());
+            // c = H(v, x_tilde, vi, x^2, v', x')
+            BN c = RSASigShareProof::Challenge(v, x_tilde_arr[item_arr[j].d], vi, sig2, vp, xp);
+            if (c != sig.c()) invalid_arr_arr[item_arr[j].d].push_back(item_arr[j].pos);
+        }
+    }
+
+    bool all_valid = true;
+    for(auto &invalid_arr : invalid_arr_arr){
+        std::sort(invalid_arr.begin(), invalid_arr.end());
+        all_valid &= invalid_arr.empty();
+    }
+    return all_valid;
+}
+
+bool Combiner::VerifySigShares(const std::string &doc,
+                               const std::vector<RSASigShare> &sig_arr,
+                               std::vector<size_t> &invalid_arr) const {
+    int jacobi_m_n = 0;
+    BN x = PrepareMessage(BN::FromBytesBE(doc), jacobi_m_n);
+    std::vector<std::vector<size_t>> invalid_arr_arr;
+    bool ok = InternalVerifySigShares({x}, {&sig_arr}, invalid_arr_arr);
+    invalid_arr = invalid_arr_arr[0];
+    return ok;
+}
+
+bool Combiner::VerifySigSharesBatch(const std::vector<std::string> &doc_arr,
+                                    const std::vector<std::vector<RSASigShare>> &sig_arr_arr,
+                                    std::vector<std::vector<size_t>> &invalid_arr_arr) const {
+    if(doc_arr.size() != sig_arr_arr.size()) return false;
+    std::vector<BN> x_arr;
+    std::vector<const std::vector<RSASigShare> *> t_sig_arr_arr;
+    for(size_t d = 0; d < doc_arr.size(); d++){
+        int jacobi_m_n = 0;
+        x_arr.push_back(PrepareMessage(BN::FromBytesBE(doc_arr[d]), jacobi_m_n));
+        t_sig_arr_arr.push_back(&sig_arr_arr[d]);
+    }
+    return InternalVerifySigShares(x_arr, t_sig_arr_arr, invalid_arr_arr);
+}
+
+bool Combiner::CombinePreparedMessage(const safeheron::bignum::BN &x,
+                                      int jacobi_m_n,
+                                      const std::vector<RSASigShare> &sig_arr,
+                                      safeheron::bignum::BN &out_sig) const {
+    // S is a subset of (1, ... ,l)
+    std::vector<int> index_arr;
+    for(const auto &item : sig_arr){
+        index_arr.push_back(item.index());
+    }
+    std::sort(index_arr.begin(), index_arr.end());
+    std::vector<BN> exp_arr;
+    if(!GetLagrangeExponents(index_arr, exp_arr)) return false;
+
+    // w = x_{i_1}^{2 \lambda_{0,i_1}^S} \dots	x_{i_k}^{2 \lambda_{0,i_k}^S} \pmod n
+    // y = w^a x^b \pmod n
+    // Both are computed in one multi-exponentiation:
+    // y = x_{i_1}^{2a \lambda_{0,i_1}^S} \dots x_{i_k}^{2a \lambda_{0,i_k}^S} x^b \pmod n
+    std::vector<BN> base_arr;
+    std::vector<BN> power_arr;
+    for(const auto &item : sig_arr){
+        size_t pos = std::lower_bound(index_arr.begin(), index_arr.end(), item.index()) - index_arr.begin();
+        base_arr.push_back(item.sig_share());
+        power_arr.push_back(exp_arr[pos] * a_);
+    }
+    base_arr.push_back(x);
+    power_arr.push_back(b_);
+    BN y = mont_n_.MultiPowM(base_arr, power_arr);
+    if (jacobi_m_n == -1) {
+        y = mont_n_.MulM(y, vku_inv_);
+    }
+    out_sig = y;
+    return true;
+}
+
+bool Combiner::InternalCombineSignatures(const safeheron::bignum::BN &_x,
+                                         const std::vector<RSASigShare> &sig_arr,
+                                         bool validate_sig,
+                                         safeheron::bignum::BN &out_sig) const {
+    int jacobi_m_n = 0;
+    BN x = PrepareMessage(_x, jacobi_m_n);
+
+    // Validate signature share
+    if(validate_sig) {
+        std::vector<std::vector<size_t>> invalid_arr_arr;
+        if (!InternalVerifySigShares({x}, {&sig_arr}, invalid_arr_arr)) {
+            return false;
+        }
+    }
+
+    return CombinePreparedMessage(x, jacobi_m_n, sig_arr, out_sig);
+}
+
+bool Combiner::CombineSignatures(const std::string &doc,
+                                 const std::vector<RSASigShare> &sig_arr,
+                                 safeheron::bignum::BN &out_sig) const {
+    BN x = BN::FromBytesBE(doc);
+    return InternalCombineSignatures(x, sig_arr, true, out_sig);
+}
+
+bool Combiner::CombineSignaturesWithoutValidation(const std::string &doc,
+                                                  const std::vector<RSASigShare> &sig_arr,
+                                                  safeheron::bignum::BN &out_sig) const {
+    BN x = BN::FromBytesBE(doc);
+    return InternalCombineSignatures(x, sig_arr, false, out_sig);
+}
+
+bool Combiner::PickSigShares(const std::vector<RSASigShare> &sig_arr,
+                             const std::vector<size_t> &excluded_arr,
+                             std::vector<RSASigShare> &picked_arr) const {
+    picked_arr.clear();
+    std::vector<bool> picked_index_arr((size_t)key_meta_.l() + 1, false);
+    for(size_t pos = 0; pos < sig_arr.size() && picked_arr.size() < (size_t)key_meta_.k(); pos++){
+        if(std::binary_search(excluded_arr.begin(), excluded_arr.end(), pos)) continue;
+        int index = sig_arr[pos].index();
+        if(index < 1 || index > key_meta_.l() || picked_index_arr[index]) continue;
+        picked_index_arr[index] = true;
+        picked_arr.push_back(sig_arr[pos]);
+    }
+    return picked_arr.size() == (size_t)key_meta_.k();
+}
+
+bool Combiner::CombineSignaturesOptimistic(const std::string &doc,
+                                           const std::vector<RSASigShare> &sig_arr,
+                                           safeheron::bignum::BN &out_sig,
+                                           std::vector<size_t> &invalid_arr) const {
+    invalid_arr.clear();
+    if(key_meta_.k() < 1) return false;
+    int jacobi_m_n = 0;
+    BN x = PrepareMessage(BN::FromBytesBE(doc), jacobi_m_n);
+
+    // Combine without validation, and check the signature with the public key.
+    std::vector<RSASigShare> picked_arr;
+    if(!PickSigShares(sig_arr, invalid_arr, picked_arr)) return false;
+    BN sig;
+    bool ok = false;
+    try {
+        ok = CombinePreparedMessage(x, jacobi_m_n, picked_arr, sig) && public_key_.VerifySignature(doc, sig);
+    } catch (const LocatedException &e) {
+        ok = false;
+    }
+    if(ok){
+        out_sig = sig;
+        return true;
+    }
+
+    // Some share is bad: find it with the proofs, and retry with the valid shares.
+    std::vector<std::vector<size_t>> invalid_arr_arr;
+    InternalVerifySigShares({x}, {&sig_arr}, invalid_arr_arr);
+    invalid_arr = invalid_arr_arr[0];
+    if(!PickSigShares(sig_arr, invalid_arr, picked_arr)) return false;
+    if(!CombinePreparedMessage(x, jacobi_m_n, picked_arr, sig) || !public_key_.VerifySignature(doc, sig)) return false;
+    out_sig = sig;
+    return true;
+}
+
+/**
+ * Number of k-subsets of m elements, or limit + 1 if it's larger than limit.
+ */
+static size_t CountSubsets(size_t m, size_t k, size_t limit) {
+    if(k > m) return 0;
+    k = std::min(k, m - k);
+    // C(m, i) = C(m, i - 1) * (m - i + 1) / i, stays exact and below (limit + 1) * m
+    size_t count = 1;
+    for(size_t i = 1; i <= k; i++){
+        count = count * (m - i + 1) / i;
+        if(count > limit) return limit + 1;
+    }
+    return count;
+}
+
+bool Combiner::CombineSignaturesWithMinimalCost(const std::string &doc,
+                                                const std::vector<RSASigShare> &sig_arr,
+                                                safeheron::bignum::BN &out_sig,
+                                                std::vector<size_t> &used_arr) const {
+    used_arr.clear();
+    const size_t k = key_meta_.k() < 1 ? 0 : (size_t)key_meta_.k();
+    if(k == 0) return false;
+    int jacobi_m_n = 0;
+    BN x = PrepareMessage(BN::FromBytesBE(doc), jacobi_m_n);
+
+    std::vector<bool> excluded_arr(sig_arr.size(), false);
+    while(true){
+        // The responding parties, with the position of the first share of each.
+        std::map<int, size_t> pos_map;
+        for(size_t pos = 0; pos < sig_arr.size(); pos++){
+            int index = sig_arr[pos].index();
+            if(excluded_arr[pos] || index < 1 || index > key_meta_.l()) continue;
+            pos_map.insert(std::make_pair(index, pos));
+        }
+        std::vector<int> index_arr;
+        for(const auto &item : pos_map){
+            index_arr.push_back(item.first);
+        }
+        const size_t m = index_arr.size();
+        if(m < k) return false;
+
+        // Pick the cheapest candidate signer set.
+        std::vector<int> best_arr;
+        size_t best_cost = 0;
+        auto try_subset = [&](const std::vector<int> &subset) {
+            size_t cost = 0;
+            if(!GetSubsetCost(subset, cost)) return;
+            if(best_arr.empty() || cost < best_cost){
+                best_arr = subset;
+                best_cost = cost;
+            }
+        };
+        std::vector<int> subset(k);
+        if(CountSubsets(m, k, MAX_SUBSET_CANDIDATES) <= MAX_SUBSET_CANDIDATES){
+            // All the k-subsets, with c as the positions in index_arr in lexicographic order.
+            std::vector<size_t> c(k);
+            for(size_t i = 0; i < k; i++) c[i] = i;
+            while(true){
+                for(size_t i = 0; i < k; i++) subset[i] = index_arr[c[i]];
+                try_subset(subset);
+                size_t i = k;
+                while(i > 0 && c[i - 1] == m - k + i - 1) i--;
+                if(i == 0) break;
+                c[i - 1]++;
+                for(size_t j = i; j < k; j++) c[j] = c[j - 1] + 1;
+            }
+        }else{
+            // Runs of k consecutive responding parties.
+            for(size_t start = 0; start + k <= m; start++){
+                for(size_t i = 0; i < k; i++) subset[i] = index_arr[start + i];
+                try_subset(subset);
+            }
+        }
+        if(best_arr.empty()) return false;
+
+        std::vector<size_t> t_used_arr;
+        std::vector<RSASigShare> picked_arr;
+        for(int index : best_arr){
+            t_used_arr.push_back(pos_map[index]);
+        }
+        std::sort(t_used_arr.begin(), t_used_arr.end());
+        for(size_t pos : t_used_arr){
+            picked_arr.push_back(sig_arr[pos]);
+        }
+
+        // Only the picked shares are validated.
+        std::vector<std::vector<size_t>> invalid_arr_arr;
+        if(!InternalVerifySigShares({x}, {&picked_arr}, invalid_arr_arr)){
+            for(size_t j : invalid_arr_arr[0]){
+                excluded_arr[t_used_arr[j]] = true;
+            }
+            continue;
+        }
+
+        if(!CombinePreparedMessage(x, jacobi_m_n, picked_arr, out_sig)) return false;
+        used_arr = t_used_arr;
+        return true;
+    }
+}
+
+bool Combiner::CombineSignaturesBatch(const std::vector<std::string> &doc_arr,
+                                      const std::vector<std::vector<RSASigShare>> &sig_arr_arr,
+                                      int thread_num,
+                                      std::vector<safeheron::bignum::BN> &out_sig_arr,
+                                      std::vector<size_t> &failed_arr) const {
+    if(doc_arr.size() != sig_arr_arr.size()) return false;
+    const size_t count = doc_arr.size();
+    if(thread_num < 1) thread_num = 1;
+    const size_t group_num = std::min(count, (size_t)thread_num);
+    const size_t group_size = group_num == 0 ? 0 : (count + group_num - 1) / group_num;
+
+    out_sig_arr.assign(count, BN(0));
+    std::vector<char> ok_arr(count, 0);
+    ParallelFor(group_num, thread_num, [&](size_t g) {
+        size_t begin = g * group_size;
+        size_t end = std::min(count, begin + group_size);
+        std::vector<BN> x_arr;
+        std::vector<int> jacobi_arr;
+        std::vector<const std::vector<RSASigShare> *> t_sig_arr_arr;
+        for(size_t d = begin; d < end; d++){
+            int jacobi_m_n = 0;
+            x_arr.push_back(PrepareMessage(BN::FromBytesBE(doc_arr[d]), jacobi_m_n));
+            jacobi_arr.push_back(jacobi_m_n);
+            t_sig_arr_arr.push_back(&sig_arr_arr[d]);
+        }
+
+        std::vector<std::vector<size_t>> invalid_arr_arr;
+        InternalVerifySigShares(x_arr, t_sig_arr_arr, invalid_arr_arr);
+
+        for(size_t t = 0; t < x_arr.size(); t++){
+            if(!invalid_arr_arr[t].empty()) continue;
+            ok_arr[begin + t] = CombinePreparedMessage(x_arr[t], jacobi_arr[t], *t_sig_arr_arr[t], out_sig_arr[begin + t]);
+        }
+    });
+
+    failed_arr.clear();
+    for(size_t d = 0; d < count; d++){
+        if(!ok_arr[d]) failed_arr.push_back(d);
+    }
+    return failed_arr.empty();
+}
+
+};
+};
@@ -0,0 +1,279 @@
+#ifndef SAFEHERON_TSS_RSA_COMBINER_H
+#define SAFEHERON_TSS_RSA_COMBINER_H
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "crypto-bn/bn.h"
+#include "MontContext.h"
+#include "RSAKeyMeta.h"
+#include "RSAPublicKey.h"
+#include "RSASigShare.h"
+
+namespace safeheron {
+namespace tss_rsa{
+
+/**
+ * Combiner of signature shares under a fixed key.
+ *
+ * The values which only depend on the key are computed once in the constructor:
+ *   - \Delta = l!
+ *   - (a, b) such that 4a + eb = 1
+ *   - vku^e mod n and vku^{-1} mod n
+ *   - the Montgomery context of n
+ * If the key meta data holds fixed-base tables ("RSAKeyMeta::BuildFixedBaseTables"), the proofs
+ * are verified with them.
+ * The exponents $$2\lambda_{0,i}^S$$ are computed on the first use of a signer set S and then
+ * memoized, so combining with a known signer set only does the exponentiations that depend on
+ * the document.
+ * The memoized exponents and the costs of "GetSubsetCost" each hold at most
+ * MAX_CACHED_SIGNER_SETS signer sets; a cache which is full is cleared before the next insert.
+ *
+ * All the public methods are const and thread safe.
+ */
+class Combiner{
+public:
+    /**
+     * Constructor.
+     * @param[in] public_key public key.
+     * @param[in] key_meta key meta data.
+     */
+    Combiner(const RSAPublicKey &public_key, const RSAKeyMeta &key_meta);
+
+    Combiner(const Combiner &other);
+
+    const RSAPublicKey &public_key() const;
+
+    const RSAKeyMeta &key_meta() const;
+
+    const MontContext &mont_n() const;
+
+    /**
+     * Combine all the shares of signature to make a real signature.
+     * @param[in] doc: doc
+     * @param[in] sig_arr : the shares of signature.
+     * @param[out] out_sig: a real signature.
+     * @return true on success, false on error.
+     */
+    bool CombineSignatures(const std::string &doc,
+                           const std::vector<RSASigShare> &sig_arr,
+                           safeheron::bignum::BN &out_sig) const;
+
+    /**
+     * Combine all the shares of signature without validation on signature shares to make a real signature.
+     * @param[in] doc: doc
+     * @param[in] sig_arr : the shares of signature.
+     * @param[out] out_sig: a real signature.
+     * @return true on success, false on error.
+     */
+    bool CombineSignaturesWithoutValidation(const std::string &doc,
+                                            const std::vector<RSASigShare> &sig_arr,
+                                            safeheron::bignum::BN &out_sig) const;
+
+    /**
+     * Combine the shares of signature optimistically.
+     *
+     * The first k shares of distinct parties are combined without validation, and the result is
+     * checked with the public key, which costs one exponentiation by e. Only if the check fails
+     * are the proofs of all the shares verified; the shares with an invalid proof are excluded,
+     * and the first k valid shares, including the spare ones, are combined again.
+     * @param[in] doc: doc
+     * @param[in] sig_arr : the shares of signature, at least k of them, and any spare ones.
+     * @param[out] out_sig: a real signature.
+     * @param[out] invalid_arr : positions in sig_arr of the shares with an invalid proof, empty if the first try succeeds.
+     * @return true on success, false if there are not k valid shares.
+     */
+    bool CombineSignaturesOptimistic(const std::string &doc,
+                                     const std::vector<RSASigShare> &sig_arr,
+                                     safeheron::bignum::BN &out_sig,
+                                     std::vector<size_t> &invalid_arr) const;
+
+    /**
+     * Combine the shares of k parties chosen to make the combination cheapest.
+     *
+     * When more than k parties respond, any k of them make the signature, but the exponents
+     * $$2a\lambda_{0,i}^S$$ of the combination depend on the signer set S. Among the k-subsets of
+     * the responding parties, the one with the smallest total bit length of the exponents is
+     * picked (when there are more than MAX_SUBSET_CANDIDATES subsets, only the runs of k
+     * consecutive responding parties are considered). The costs of the signer sets are memoized
+     * per key. Only the proofs of the picked shares are verified; if some are invalid they are
+     * excluded and another subset is picked. Most of the gain over "CombineSignatures" with all
+     * the shares comes from verifying k proofs instead of all of them; the choice of S trims the
+     * exponents by a few bits each.
+     * @param[in] doc: doc
+     * @param[in] sig_arr : the shares of signature, at least k of them.
+     * @param[out] out_sig: a real signature.
+     * @param[out] used_arr : positions in sig_arr of the shares combined, in ascending order.
+     * @return true on success, false if there are not k valid shares.
+     */
+    bool CombineSignaturesWithMinimalCost(const std::string &doc,
+                                          const std::vector<RSASigShare> &sig_arr,
+                                          safeheron::bignum::BN &out_sig,
+                                          std::vector<size_t> &used_arr) const;
+
+    /**
+     * Get the cost of combining the shares of signer set S: the total bit length of $$2a\lambda_{0,i}^S$$.
+     * @param[in] index_arr: signer set S, sorted in ascending order.
+     * @param[out] cost: cost of S.
+     * @return true on success, false if S is not a valid signer set.
+     */
+    bool GetSubsetCost(const std::vector<int> &index_arr, size_t &cost) const;
+
+    /**
+     * Maximal number of k-subsets compared by "CombineSignaturesWithMinimalCost".
+     */
+    static const size_t MAX_SUBSET_CANDIDATES = 256;
+
+    /**
+     * Maximal number of signer sets kept in each of the caches of exponents and costs.
+     */
+    static const size_t MAX_CACHED_SIGNER_SETS = 1024;
+
+    /**
+     * Combine the shares of signature of many documents under this key.
+     *
+     * The documents are split into thread_num groups which run in parallel. Within a group the
+     * proofs of all the shares are verified together (see "VerifySigSharesBatch"), and then the
+     * documents whose shares are all valid are combined.
+     * @param[in] doc_arr: documents.
+     * @param[in] sig_arr_arr : sig_arr_arr[d] are the shares of signature of doc_arr[d].
+     * @param[in] thread_num: number of threads, 1 to combine in the calling thread.
+     * @param[out] out_sig_arr: out_sig_arr[d] is the real signature of doc_arr[d], or 0 if it failed.
+     * @param[out] failed_arr: positions in doc_arr of the documents which could not be combined.
+     * @return true if all the documents are combined, false otherwise.
+     */
+    bool CombineSignaturesBatch(const std::vector<std::string> &doc_arr,
+                                const std::vector<std::vector<RSASigShare>> &sig_arr_arr,
+                                int thread_num,
+                                std::vector<safeheron::bignum::BN> &out_sig_arr,
+                                std::vector<size_t> &failed_arr) const;
+
+    /**
+     * Verify the proofs of the signature shares of a document together.
+     *
+     * The exponentiations of the common bases (vkv, and x^4 of the document) are batched so
+     * that they share one chain of squarings, and the signature shares are inverted with one
+     * modular inversion. Every proof is still checked exactly, so the invalid shares are
+     * reported directly.
+     * @param[in] doc: doc
+     * @param[in] sig_arr : the shares of signature.
+     * @param[out] invalid_arr : positions in sig_arr of the shares with an invalid proof.
+     * @return true if all the proofs are valid, false otherwise.
+     */
+    bool VerifySigShares(const std::string &doc,
+                         const std::vector<RSASigShare> &sig_arr,
+                         std::vector<size_t> &invalid_arr) const;
+
+    /**
+     * Verify the proofs of the signature shares of many documents under this key together.
+     * @param[in] doc_arr: documents.
+     * @param[in] sig_arr_arr : sig_arr_arr[d] are the shares of signature of doc_arr[d].
+     * @param[out] invalid_arr_arr : invalid_arr_arr[d] are the positions in sig_arr_arr[d] of the shares with an invalid proof.
+     * @return true if all the proofs are valid, false otherwise.
+     */
+    bool VerifySigSharesBatch(const std::vector<std::string> &doc_arr,
+                              const std::vector<std::vector<RSASigShare>> &sig_arr_arr,
+                              std::vector<std::vector<size_t>> &invalid_arr_arr) const;
+
+    /**
+     * Get the exponents $$2\lambda_{0,i}^S$$ of signer set S.
+     * @param[in] index_arr: signer set S, sorted in ascending order.
+     * @param[out] exp_arr: exponents, exp_arr[j] is the exponent of signer index_arr[j].
+     * @return true on success, false if S is not a valid signer set.
+     */
+    bool GetLagrangeExponents(const std::vector<int> &index_arr,
+                              std::vector<safeheron::bignum::BN> &exp_arr) const;
+
+private:
+    friend class CombineSession;
+
+    Combiner &operator=(const Combiner &other);
+
+    /**
+     * Check a signer set S: a sorted subset of (1, ... ,l) without duplicates.
+     */
+    bool IsValidSignerSet(const std::vector<int> &index_arr) const;
+
+    /**
+     * Compute the exponents $$2\lambda_{0,i}^S$$ of a valid signer set S, without memoizing them.
+     */
+    void ComputeLagrangeExponents(const std::vector<int> &index_arr,
+                                  std::vector<safeheron::bignum::BN> &exp_arr) const;
+
+    /**
+     * Map the message into Z_n^* with Jacobi symbol 1.
+     * @param[in] x: a big number related to prepared hash
+     * @param[out] jacobi_m_n: Jacobi symbol of the message.
+     * @return x if jacobi(x, n) != -1, x * vku^e otherwise.
+     */
+    safeheron::bignum::BN PrepareMessage(const safeheron::bignum::BN &x, int &jacobi_m_n) const;
+
+    /**
+     * Verify the proofs of the signature shares of prepared messages together.
+     * @param[in] x_arr: prepared messages.
+     * @param[in] sig_arr_arr : sig_arr_arr[d] are the shares of signature of x_arr[d].
+     * @param[out] invalid_arr_arr : positions of the shares with an invalid proof.
+     * @return true if all the proofs are valid, false otherwise.
+     */
+    bool InternalVerifySigShares(const std::vector<safeheron::bignum::BN> &x_arr,
+                                 const std::vector<const std::vector<RSASigShare> *> &sig_arr_arr,
+                                 std::vector<std::vector<size_t>> &invalid_arr_arr) const;
+
+    /**
+     * Combine the shares of signature of a prepared message, without validation.
+     * @param[in] x: prepared message, see "PrepareMessage".
+     * @param[in] jacobi_m_n: Jacobi symbol of the message.
+     * @param[in] sig_arr : the shares of signature.
+     * @param[out] out_sig: a real signature.
+     * @return true on success, false if the signer set is not valid.
+     */
+    bool CombinePreparedMessage(const safeheron::bignum::BN &x,
+                                int jacobi_m_n,
+                                const std::vector<RSASigShare> &sig_arr,
+                                safeheron::bignum::BN &out_sig) const;
+
+    /**
+     * Pick the first k shares of distinct parties.
+     * @param[in] sig_arr : the shares of signature.
+     * @param[in] excluded_arr : positions in sig_arr to skip, sorted in ascending order.
+     * @param[out] picked_arr : the picked shares.
+     * @return true if k shares are picked, false otherwise.
+     */
+    bool PickSigShares(const std::vector<RSASigShare> &sig_arr,
+                       const std::vector<size_t> &excluded_arr,
+                       std::vector<RSASigShare> &picked_arr) const;
+
+    /**
+     * Combine all the shares of signature to make a real signature.
+     * @param[in] x: a big number related to prepared hash
+     * @param[in] sig_arr : the shares of signature.
+     * @param[in] validate_sig: whether to verify the proofs of signature shares.
+     * @param[out] out_sig: a real signature.
+     * @return true on success, false on error.
+     */
+    bool InternalCombineSignatures(const safeheron::bignum::BN &x,
+                                   const std::vector<RSASigShare> &sig_arr,
+                                   bool validate_sig,
+                                   safeheron::bignum::BN &out_sig) const;
+
+private:
+    RSAPublicKey public_key_;  /**< public key */
+    RSAKeyMeta key_meta_;  /**< key meta data */
+    MontContext mont_n_;  /**< Montgomery context of n */
+    safeheron::bignum::BN delta_;  /**< \Delta = l! */
+    safeheron::bignum::BN a_;  /**< 4a + eb = 1 */
+    safeheron::bignum::BN b_;  /**< 4a + eb = 1 */
+    safeheron::bignum::BN vku_e_;  /**< vku^e mod n */
+    safeheron::bignum::BN vku_inv_;  /**< vku^{-1} mod n */
+    std::vector<safeheron::bignum::BN> vki_inv_arr_;  /**< vki^{-1} mod n of all parties */
+    bool use_table_;  /**< whether the key meta data holds fixed-base tables of this key */
+    mutable std::mutex mutex_;  /**< guards exp_cache_ and cost_cache_ */
+    mutable std::map<std::vector<int>, std::vector<safeheron::bignum::BN>> exp_cache_;  /**< signer set S => 2\lambda_{0,i}^S, at most MAX_CACHED_SIGNER_SETS entries */
+    mutable std::map<std::vector<int>, size_t> cost_cache_;  /**< signer set S => total bit length of 2a\lambda_{0,i}^S, at most MAX_CACHED_SIGNER_SETS entries */
+};
+
+};
+};
+
+#endif //SAFEHERON_TSS_RSA_COMBINER_H
@@ -0,0 +1,144 @@
+#include "FixedBaseTable.h"
+#include <openssl/bn.h>
+#include "exception/located_exception.h"
+#include "scoped_bn.h"
+
+using safeheron::bignum::BN;
+using safeheron::exception::LocatedException;
+
+namespace safeheron {
+namespace tss_rsa{
+
+FixedBaseTable::FixedBaseTable(const MontContext &mont_n, const safeheron::bignum::BN &base, size_t max_exp_bits, int h)
+        : mont_n_(mont_n),
+          base_(base),
+          h_(h) {
+    if(h < 1 || h > 10){
+        throw LocatedException(__FILE__, __LINE__, __FUNCTION__, -1, "h should be in [1, 10]");
+    }
+    if(max_exp_bits == 0){
+        throw LocatedException(__FILE__, __LINE__, __FUNCTION__, -1, "max_exp_bits == 0");
+    }
+    a_ = (max_exp_bits + h - 1) / h;
+    max_exp_bits_ = a_ * h;
+    entry_size_ = (mont_n_.n().BitLength() + 63) / 64 * 8;
+
+    ScopedBNCtx ctx;
+    ScopedBIGNUM t_n(mont_n_.n());
+    BIGNUMArray pool;
+    BN_MONT_CTX *mont = mont_n_.mont_;
+
+    // g_i = g^{2^{ia}} in Montgomery form
+    std::vector<BIGNUM *> g_arr;
+    {
+        BIGNUM *g = pool.New();
+        ScopedBIGNUM t_base(base_);
+        if(!BN_nnmod(g, t_base.get(), t_n.get(), ctx.get()) ||
+           !BN_to_montgomery(g, g, mont, ctx.get())){
+            throw LocatedException(__FILE__, __LINE__, __FUNCTION__, -1, "BN_to_montgomery failed");
+        }
+        g_arr.push_back(g);
+    }
+    for(int i = 1; i < h_; i++){
+        BIGNUM *g = pool.New();
+        if(!BN_copy(g, g_arr[i - 1])){
+            throw LocatedException(__FILE__, __LINE__, __FUNCTION__, -1, "BN_copy failed");
+        }
+        for(size_t k = 0; k < a_; k++){
+            if(!BN_mod_mul_montgomery(g, g, g, mont, ctx.get())){
+                throw LocatedException(__FILE__, __LINE__, __FUNCTION__, -1, "BN_mod_mul_montgomery failed");
+            }
+        }
+        g_arr.push_back(g);
+    }
+
+    // G[0] = 1, G[b] = G[b - 2^top] * g_top where top is the highest bit of b
+    const size_t entry_num = (size_t)1 << h_;
+    std::vector<BIGNUM *> entry_arr;
+    {
+        BIGNUM *one = pool.New();
+        if(!BN_one(one) || !BN_to_montgomery(one, one, mont, ctx.get())){
+            throw LocatedException(__FILE__, __LINE__, __FUNCTION__, -1, "BN_to_montgomery failed");
+        }
+        entry_arr.push_back(one);
+    }
+    for(size_t b = 1; b < entry_num; b++){
+        int top = 0;
+        while((b >> (top + 1)) != 0) top++;
+        BIGNUM *entry = pool.New();
+        if(!BN_mod_mul_montgomery(entry, entry_arr[b - ((size_t)1 << top)], g_arr[top], mont, ctx.get())){
+            throw LocatedException(__FILE__, __LINE__, __FUNCTION__, -1, "BN_mod_mul_montgomery failed");
+        }
+        entry_arr.push_back(entry);
+    }
+
+    table_.assign(entry_num * entry_size_, 0);
+    for(size_t b = 0; b < entry_num; b++){
+        if(BN_bn2lebinpad(entry_arr[b], &table_[b * entry_size_], (int)entry_size_) < 0){
+            throw LocatedException(__FILE__, __LINE__, __FUNCTION__, -1, "BN_bn2lebinpad failed");
+        }
+    }
+}
+
+const MontContext &FixedBaseTable::mont_n() const {
+    return mont_n_;
+}
+
+const bignum::BN &FixedBaseTable::base() const {
+    return base_;
+}
+
+size_t FixedBaseTable::max_exp_bits() const {
+    return max_exp_bits_;
+}
+
+BN FixedBaseTable::PowM(const safeheron::bignum::BN &exp) const {
+    if(exp.IsNeg() || exp.BitLength() > max_exp_bits_){
+        return mont_n_.PowM(base_, exp);
+    }
+    ScopedBNCtx ctx;
+    ScopedBIGNUM t_exp(exp), acc, entry;
+    BN_MONT_CTX *mont = mont_n_.mont_;
+
+    bool acc_is_one = true;
+    for(size_t j = a_; j-- > 0; ){
+        if(!acc_is_one && !BN_mod_mul_montgomery(acc.get(), acc.get(), acc.get(), mont, ctx.get())){
+            throw LocatedException(__FILE__, __LINE__, __FUNCTION__, -1, "BN_mod_mul_montgomery failed");
+        }
+        size_t idx = 0;
+        for(int i = 0; i < h_; i++){
+            idx |= (size_t)BN_is_bit_set(t_exp.get(), (int)(i * a_ + j)) << i;
+        }
+        if(idx == 0) continue;
+        if(!BN_lebin2bn(&table_[idx * entry_size_], (int)entry_size_, acc_is_one ? acc.get() : entry.get())){
+            throw LocatedException(__FILE__, __LINE__, __FUNCTION__, -1, "BN_lebin2bn failed");
+        }
+        if(acc_is_one){
+            acc_is_one = false;
+        }else if(!BN_mod_mul_montgomery(acc.get(), acc.get(), entry.get(), mont, ctx.get())){
+            throw LocatedException(__FILE__, __LINE__, __FUNCTION__, -1, "BN_mod_mul_montgomery failed");
+        }
+    }
+
+    ScopedBIGNUM ret;
+    if(acc_is_one){
+        ScopedBIGNUM t_n(mont_n_.n());
+        if(!BN_one(ret.get()) || !BN_nnmod(ret.get(), ret.get(), t_n.get(), ctx.get())){
+            throw LocatedException(__FILE__, __LINE__, __FUNCTION__, -1, "BN_one failed");
+        }
+    }else if(!BN_from_montgomery(ret.get(), acc.get(), mont, ctx.get())){
+        throw LocatedException(__FILE__, __LINE__, __FUNCTION__, -1, "BN_from_montgomery failed");
+    }
+    return ret.ToBN();
+}
+
+size_t FixedBaseTable::MemorySize() const {
+    return table_.size();
+}
+
+size_t FixedBaseTable::MemorySize(size_t n_bits, int h) {
+    return ((size_t)1 << h) * ((n_bits + 63) / 64 * 8);
+}
+
+};
+};
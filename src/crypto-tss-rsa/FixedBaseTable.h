@@ -0,0 +1,78 @@
+#ifndef SAFEHERON_TSS_RSA_FIXED_BASE_TABLE_H
+#define SAFEHERON_TSS_RSA_FIXED_BASE_TABLE_H
+
+#include <cstdint>
+#include <vector>
+#include "crypto-bn/bn.h"
+#include "MontContext.h"
+
+namespace safeheron {
+namespace tss_rsa{
+
+/**
+ * Precomputed table of a fixed base g modulo n, for exponents of at most max_exp_bits bits (Lim-Lee comb).
+ *
+ * An exponent is cut into h rows of a = ceil(max_exp_bits / h) bits:
+ *     exp = exp_0 + exp_1 * 2^a + ... + exp_{h-1} * 2^{(h-1)a}
+ * and the table holds the 2^h products
+ *     G[b] = \prod_{i: bit i of b is set} g^{2^{ia}}
+ * so that g^exp costs a squarings and a multiplications, instead of about max_exp_bits squarings.
+ *
+ * The table takes 2^h * 8 * ceil(L(n) / 64) bytes, see "MemorySize".
+ * The comb is not constant time, so the table only serves public exponents. Secret exponents go
+ * through "MontContext::PowMSecret".
+ * A FixedBaseTable is immutable after construction and may be shared between threads.
+ */
+class FixedBaseTable{
+public:
+    /**
+     * Constructor.
+     * @param[in] mont_n Montgomery context of n.
+     * @param[in] base the fixed base g.
+     * @param[in] max_exp_bits maximum bit length of the exponents.
+     * @param[in] h number of rows of the comb, 1 <= h <= 10.
+     */
+    FixedBaseTable(const MontContext &mont_n, const safeheron::bignum::BN &base, size_t max_exp_bits, int h);
+
+    const MontContext &mont_n() const;
+
+    const safeheron::bignum::BN &base() const;
+
+    size_t max_exp_bits() const;
+
+    /**
+     * Compute g^exp mod n.
+     * @note Not constant time. Only use it with public exponents.
+     * @param[in] exp exp >= 0. Exponents longer than max_exp_bits fall back to "MontContext::PowM".
+     * @return g^exp mod n
+     */
+    safeheron::bignum::BN PowM(const safeheron::bignum::BN &exp) const;
+
+    /**
+     * Get the memory taken by the table.
+     * @return size in bytes.
+     */
+    size_t MemorySize() const;
+
+    /**
+     * Get the memory taken by a table of a modulus of n_bits bits.
+     * @param[in] n_bits bit length of n.
+     * @param[in] h number of rows of the comb.
+     * @return size in bytes.
+     */
+    static size_t MemorySize(size_t n_bits, int h);
+
+private:
+    MontContext mont_n_;  /**< Montgomery context of n */
+    safeheron::bignum::BN base_;  /**< the fixed base g */
+    size_t max_exp_bits_;  /**< maximum bit length of the exponents, h * a */
+    int h_;  /**< number of rows */
+    size_t a_;  /**< number of columns, the bit length of a row */
+    size_t entry_size_;  /**< bytes of an entry, L(n) rounded up to 64 bits */
+    std::vector<uint8_t> table_;  /**< G[0], ..., G[2^h - 1] in Montgomery form, little endian, entry_size_ bytes each */
+};
+
+};
+};
+
+#endif //SAFEHERON_TSS_RSA_FIXED_BASE_TABLE_H
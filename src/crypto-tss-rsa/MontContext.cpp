@@ -0,0 +1,434 @@
+#include "MontContext.h"
+#include <string>
+#include <vector>
+#include <openssl/bn.h>
+#include <openssl/crypto.h>
+#include <openssl/err.h>
+#include "exception/located_exception.h"
+#include "scoped_bn.h"
+
+using safeheron::bignum::BN;
+using safeheron::exception::LocatedException;
+
+namespace safeheron {
+namespace tss_rsa{
+
+namespace {
+
+/**
+ * Window size of the sliding window method, the same thresholds as OpenSSL.
+ */
+int WindowBits(int bits) {
+    return bits > 671 ? 6 : bits > 239 ? 5 : bits > 79 ? 4 : bits > 23 ? 3 : 1;
+}
+
+/**
+ * A digit of the sliding window recoding: exp = \sum digit * 2^pos, digit is odd.
+ */
+struct WindowDigit{
+    int pos;
+    int digit;
+};
+
+/**
+ * Recode the exponent into odd digits of at most w bits, from the most significant one.
+ */
+void SlidingWindowRecode(const BIGNUM *exp, int w, std::vector<WindowDigit> &digit_arr) {
+    digit_arr.clear();
+    int i = BN_num_bits(exp) - 1;
+    while(i >= 0){
+        if(!BN_is_bit_set(exp, i)){
+            i--;
+            continue;
+        }
+        int j = i - w + 1 > 0 ? i - w + 1 : 0;
+        while(!BN_is_bit_set(exp, j)) j++;
+        int digit = 0;
+        for(int t = i; t >= j; t--){
+            digit = (digit << 1) | (BN_is_bit_set(exp, t) ? 1 : 0);
+        }
+        digit_arr.push_back({j, digit});
+        i = j - 1;
+    }
+}
+
+/**
+ * State of one exponentiation inside a multi-exponentiation.
+ */
+struct MultiPowMTerm{
+    std::vector<BIGNUM *> table;  /**< g, g^3, g^5, ... in Montgomery form */
+    std::vector<WindowDigit> digit_arr;
+    size_t next;  /**< next digit to consume */
+    bool negative;
+};
+
+}
+
+MontContext::MontContext(const safeheron::bignum::BN &n) : n_(n), mont_(nullptr) {
+    if(n_ <= 1 || !n_.IsOdd()){
+        throw LocatedException(__FILE__, __LINE__, __FUNCTION__, -1, "n should be odd and greater than 1");
+    }
+    ScopedBNCtx ctx;
+    ScopedBIGNUM t_n(n_);
+    mont_ = BN_MONT_CTX_new();
+    if(!mont_ || !BN_MONT_CTX_set(mont_, t_n.get(), ctx.get())){
+        BN_MONT_CTX_free(mont_);
+        throw LocatedException(__FILE__, __LINE__, __FUNCTION__, -1, "BN_MONT_CTX_set failed");
+    }
+}
+
+MontContext::MontContext(const MontContext &other) : n_(other.n_), mont_(BN_MONT_CTX_new()) {
+    if(!mont_ || !BN_MONT_CTX_copy(mont_, other.mont_)){
+        BN_MONT_CTX_free(mont_);
+        throw LocatedException(__FILE__, __LINE__, __FUNCTION__, -1, "BN_MONT_CTX_copy failed");
+    }
+}
+
+MontContext &MontContext::operator=(const MontContext &other) {
+    if(this != &other){
+        if(!BN_MONT_CTX_copy(mont_, other.mont_)){
+            throw LocatedException(__FILE__, __LINE__, __FUNCTION__, -1, "BN_MONT_CTX_copy failed");
+        }
+        n_ = other.n_;
+    }
+    return *this;
+}
+
+MontContext::~MontContext() {
+    BN_MONT_CTX_free(mont_);
+}
+
+const bignum::BN &MontContext::n() const {
+    return n_;
+}
+
+BN MontContext::PowM(const safeheron::bignum::BN &base, const safeheron::bignum::BN &exp) const {
+    if(exp.IsNeg()){
+        return PowM(base.InvM(n_), exp.Neg());
+    }
+    ScopedBNCtx ctx;
+    ScopedBIGNUM t_base(base), t_exp(exp), t_n(n_), ret;
+    if(!BN_nnmod(t_base.get(), t_base.get(), t_n.get(), ctx.get()) ||
+       !BN_mod_exp_mont(ret.get(), t_base.get(), t_exp.get(), t_n.get(), ctx.get(), mont_)){
+        throw LocatedException(__FILE__, __LINE__, __FUNCTION__, -1, "BN_mod_exp_mont failed");
+    }
+    return ret.ToBN();
+}
+
+BN MontContext::PowMWord(const safeheron::bignum::BN &base, uint64_t exp) const {
+    ScopedBNCtx ctx;
+    ScopedBIGNUM t_base(base), t_n(n_), ret;
+    if(exp == 0){
+        if(!BN_one(ret.get()) || !BN_nnmod(ret.get(), ret.get(), t_n.get(), ctx.get())){
+            throw LocatedException(__FILE__, __LINE__, __FUNCTION__, -1, "BN_one failed");
+        }
+        return ret.ToBN();
+    }
+    if(!BN_nnmod(t_base.get(), t_base.get(), t_n.get(), ctx.get()) ||
+       !BN_to_montgomery(t_base.get(), t_base.get(), mont_, ctx.get()) ||
+       !BN_copy(ret.get(), t_base.get())){
+        throw LocatedException(__FILE__, __LINE__, __FUNCTION__, -1, "BN_to_montgomery failed");
+    }
+    int top = 63;
+    while(!((exp >> top) & 1)) top--;
+    for(int i = top - 1; i >= 0; i--){
+        if(!BN_mod_mul_montgomery(ret.get(), ret.get(), ret.get(), mont_, ctx.get())){
+            throw LocatedException(__FILE__, __LINE__, __FUNCTION__, -1, "BN_mod_mul_montgomery failed");
+        }
+        if(((exp >> i) & 1) && !BN_mod_mul_montgomery(ret.get(), ret.get(), t_base.get(), mont_, ctx.get())){
+            throw LocatedException(__FILE__, __LINE__, __FUNCTION__, -1, "BN_mod_mul_montgomery failed");
+        }
+    }
+    if(!BN_from_montgomery(ret.get(), ret.get(), mont_, ctx.get())){
+        throw LocatedException(__FILE__, __LINE__, __FUNCTION__, -1, "BN_from_montgomery failed");
+    }
+    return ret.ToBN();
+}
+
+BN MontContext::PowMSecret(const safeheron::bignum::BN &base, const safeheron::bignum::BN &exp) const {
+    if(exp.IsNeg()){
+        throw LocatedException(__FILE__, __LINE__, __FUNCTION__, -1, "exp < 0");
+    }
+    ScopedBNCtx ctx;
+    ScopedBIGNUM t_base(base), t_exp(exp), t_n(n_), ret;
+    BN_set_flags(t_exp.get(), BN_FLG_CONSTTIME);
+    if(!BN_nnmod(t_base.get(), t_base.get(), t_n.get(), ctx.get()) ||
+       !BN_mod_exp_mont_consttime(ret.get(), t_base.get(), t_exp.get(), t_n.get(), ctx.get(), mont_)){
+        throw LocatedException(__FILE__, __LINE__, __FUNCTION__, -1, "BN_mod_exp_mont_consttime failed");
+    }
+    return ret.ToBN();
+}
+
+BN MontContext::MultiPowM(const std::vector<safeheron::bignum::BN> &base_arr,
+                          const std::vector<safeheron::bignum::BN> &exp_arr) const {
+    if(base_arr.size() != exp_arr.size()){
+        throw LocatedException(__FILE__, __LINE__, __FUNCTION__, -1, "base_arr.size() != exp_arr.size()");
+    }
+    ScopedBNCtx ctx;
+    ScopedBIGNUM t_n(n_);
+    BIGNUMArray pool;
+
+    // Precompute the odd powers of every base in Montgomery form.
+    std::vector<MultiPowMTerm> term_arr;
+    int max_bits = 0;
+    for(size_t i = 0; i < base_arr.size(); i++){
+        if(exp_arr[i].IsZero()) continue;
+        MultiPowMTerm term;
+        term.negative = exp_arr[i].IsNeg();
+        term.next = 0;
+        ScopedBIGNUM t_exp(term.negative ? exp_arr[i].Neg() : exp_arr[i]);
+        int bits = BN_num_bits(t_exp.get());
+        int w = WindowBits(bits);
+        SlidingWindowRecode(t_exp.get(), w, term.digit_arr);
+
+        BIGNUM *g = pool.New();
+        ScopedBIGNUM t_base(base_arr[i]);
+        if(!BN_nnmod(g, t_base.get(), t_n.get(), ctx.get()) ||
+           !BN_to_montgomery(g, g, mont_, ctx.get())){
+            throw LocatedException(__FILE__, __LINE__, __FUNCTION__, -1, "BN_to_montgomery failed");
+        }
+        term.table.push_back(g);
+        if(w > 1){
+            BIGNUM *g2 = pool.New();
+            if(!BN_mod_mul_montgomery(g2, g, g, mont_, ctx.get())){
+                throw LocatedException(__FILE__, __LINE__, __FUNCTION__, -1, "BN_mod_mul_montgomery failed");
+            }
+            for(int t = 1; t < (1 << (w - 1)); t++){
+                BIGNUM *item = pool.New();
+                if(!BN_mod_mul_montgomery(item, term.table[t - 1], g2, mont_, ctx.get())){
+                    throw LocatedException(__FILE__, __LINE__, __FUNCTION__, -1, "BN_mod_mul_montgomery failed");
+                }
+                term.table.push_back(item);
+            }
+        }
+        if(bits > max_bits) max_bits = bits;
+        term_arr.push_back(term);
+    }
+
+    // acc[0] accumulates the positive exponents, acc[1] the negative ones.
+    BIGNUM *acc[2] = {pool.New(), pool.New()};
+    bool acc_is_one[2] = {true, true};
+    for(int pos = max_bits - 1; pos >= 0; pos--){
+        for(int s = 0; s < 2; s++){
+            if(!acc_is_one[s] && !BN_mod_mul_montgomery(acc[s], acc[s], acc[s], mont_, ctx.get())){
+                throw LocatedException(__FILE__, __LINE__, __FUNCTION__, -1, "BN_mod_mul_montgomery failed");
+            }
+        }
+        for(auto &term : term_arr){
+            if(term.next >= term.digit_arr.size() || term.digit_arr[term.next].pos != pos) continue;
+            const BIGNUM *factor = term.table[term.digit_arr[term.next].digit >> 1];
+            int s = term.negative ? 1 : 0;
+            if(acc_is_one[s]){
+                if(!BN_copy(acc[s], factor)){
+                    throw LocatedException(__FILE__, __LINE__, __FUNCTION__, -1, "BN_copy failed");
+                }
+                acc_is_one[s] = false;
+            }else if(!BN_mod_mul_montgomery(acc[s], acc[s], factor, mont_, ctx.get())){
+                throw LocatedException(__FILE__, __LINE__, __FUNCTION__, -1, "BN_mod_mul_montgomery failed");
+            }
+            term.next++;
+        }
+    }
+
+    // ret = acc[0] * acc[1]^{-1}
+    ScopedBIGNUM ret;
+    if(acc_is_one[0]){
+        if(!BN_one(ret.get())){
+            throw LocatedException(__FILE__, __LINE__, __FUNCTION__, -1, "BN_one failed");
+        }
+    }else if(!BN_from_montgomery(ret.get(), acc[0], mont_, ctx.get())){
+        throw LocatedException(__FILE__, __LINE__, __FUNCTION__, -1, "BN_from_montgomery failed");
+    }
+    if(!acc_is_one[1]){
+        BIGNUM *t = pool.New();
+        if(!BN_from_montgomery(t, acc[1], mont_, ctx.get()) ||
+           !BN_mod_inverse(t, t, t_n.get(), ctx.get()) ||
+           !BN_mod_mul(ret.get(), ret.get(), t, t_n.get(), ctx.get())){
+            throw LocatedException(__FILE__, __LINE__, __FUNCTION__, -1, "InvM failed");
+        }
+    }
+    return ret.ToBN();
+}
+
+std::vector<BN> MontContext::BatchPowM(const safeheron::bignum::BN &base,
+                                       const std::vector<safeheron::bignum::BN> &exp_arr) const {
+    std::vector<BN> ret_arr;
+    if(exp_arr.size() == 1){
+        ret_arr.push_back(PowM(base, exp_arr[0]));
+        return ret_arr;
+    }
+    ScopedBNCtx ctx;
+    ScopedBIGNUM t_n(n_);
+    BIGNUMArray pool;
+
+    int max_bits = 0;
+    std::vector<BIGNUM *> exp_bn_arr;
+    for(const auto &exp : exp_arr){
+        if(exp.IsNeg()){
+            throw LocatedException(__FILE__, __LINE__, __FUNCTION__, -1, "exp < 0");
+        }
+        BIGNUM *t_exp = pool.New();
+        ScopedBIGNUM t(exp);
+        if(!BN_copy(t_exp, t.get())){
+            throw LocatedException(__FILE__, __LINE__, __FUNCTION__, -1, "BN_copy failed");
+        }
+        exp_bn_arr.push_back(t_exp);
+        if(BN_num_bits(t_exp) > max_bits) max_bits = BN_num_bits(t_exp);
+    }
+
+    // Choose w to minimize max_bits + m * (max_bits / w + 2^w).
+    int w = 1;
+    double best_cost = -1;
+    for(int t = 1; t <= 8; t++){
+        double cost = exp_arr.size() * ((double)max_bits / t + (1 << t));
+        if(best_cost < 0 || cost < best_cost){
+            best_cost = cost;
+            w = t;
+        }
+    }
+
+    // g_t = base^{2^{wt}} in Montgomery form
+    int digits = (max_bits + w - 1) / w;
+    std::vector<BIGNUM *> g_arr;
+    {
+        BIGNUM *g = pool.New();
+        ScopedBIGNUM t_base(base);
+        if(!BN_nnmod(g, t_base.get(), t_n.get(), ctx.get()) ||
+           !BN_to_montgomery(g, g, mont_, ctx.get())){
+            throw LocatedException(__FILE__, __LINE__, __FUNCTION__, -1, "BN_to_montgomery failed");
+        }
+        g_arr.push_back(g);
+    }
+    for(int t = 1; t < digits; t++){
+        BIGNUM *g = pool.New();
+        if(!BN_copy(g, g_arr[t - 1])){
+            throw LocatedException(__FILE__, __LINE__, __FUNCTION__, -1, "BN_copy failed");
+        }
+        for(int k = 0; k < w; k++){
+            if(!BN_mod_mul_montgomery(g, g, g, mont_, ctx.get())){
+                throw LocatedException(__FILE__, __LINE__, __FUNCTION__, -1, "BN_mod_mul_montgomery failed");
+            }
+        }
+        g_arr.push_back(g);
+    }
+
+    // base^exp = \prod_{d=1}^{2^w - 1} ( \prod_{t: digit_t = d} g_t )^d
+    BIGNUM *A = pool.New();
+    BIGNUM *B = pool.New();
+    ScopedBIGNUM ret;
+    std::vector<int> digit_arr(digits);
+    for(BIGNUM *exp : exp_bn_arr){
+        int max_digit = 0;
+        for(int t = 0; t < digits; t++){
+            int digit = 0;
+            for(int k = w - 1; k >= 0; k--){
+                digit = (digit << 1) | (BN_is_bit_set(exp, t * w + k) ? 1 : 0);
+            }
+            digit_arr[t] = digit;
+            if(digit > max_digit) max_digit = digit;
+        }
+        bool A_is_one = true, B_is_one = true;
+        for(int d = max_digit; d >= 1; d--){
+            for(int t = 0; t < digits; t++){
+                if(digit_arr[t] != d) continue;
+                if(B_is_one){
+                    if(!BN_copy(B, g_arr[t])){
+                        throw LocatedException(__FILE__, __LINE__, __FUNCTION__, -1, "BN_copy failed");
+                    }
+                    B_is_one = false;
+                }else if(!BN_mod_mul_montgomery(B, B, g_arr[t], mont_, ctx.get())){
+                    throw LocatedException(__FILE__, __LINE__, __FUNCTION__, -1, "BN_mod_mul_montgomery failed");
+                }
+            }
+            if(B_is_one) continue;
+            if(A_is_one){
+                if(!BN_copy(A, B)){
+                    throw LocatedException(__FILE__, __LINE__, __FUNCTION__, -1, "BN_copy failed");
+                }
+                A_is_one = false;
+            }else if(!BN_mod_mul_montgomery(A, A, B, mont_, ctx.get())){
+                throw LocatedException(__FILE__, __LINE__, __FUNCTION__, -1, "BN_mod_mul_montgomery failed");
+            }
+        }
+        if(A_is_one){
+            ret_arr.push_back(BN(1));
+            continue;
+        }
+        if(!BN_from_montgomery(ret.get(), A, mont_, ctx.get())){
+            throw LocatedException(__FILE__, __LINE__, __FUNCTION__, -1, "BN_from_montgomery failed");
+        }
+        ret_arr.push_back(ret.ToBN());
+    }
+    return ret_arr;
+}
+
+bool MontContext::BatchInvM(const std::vector<safeheron::bignum::BN> &a_arr,
+                            std::vector<safeheron::bignum::BN> &inv_arr) const {
+    inv_arr.clear();
+    if(a_arr.empty()) return true;
+    ScopedBNCtx ctx;
+    ScopedBIGNUM t_n(n_);
+    BIGNUMArray pool;
+
+    // prefix_arr[j] = a_0 * ... * a_j
+    std::vector<BIGNUM *> a_bn_arr;
+    std::vector<BIGNUM *> prefix_arr;
+    for(size_t j = 0; j < a_arr.size(); j++){
+        BIGNUM *a = pool.New();
+        BIGNUM *prefix = pool.New();
+        ScopedBIGNUM t(a_arr[j]);
+        if(!BN_nnmod(a, t.get(), t_n.get(), ctx.get())){
+            throw LocatedException(__FILE__, __LINE__, __FUNCTION__, -1, "BN_nnmod failed");
+        }
+        if(j == 0){
+            if(!BN_copy(prefix, a)){
+                throw LocatedException(__FILE__, __LINE__, __FUNCTION__, -1, "BN_copy failed");
+            }
+        }else if(!BN_mod_mul(prefix, prefix_arr[j - 1], a, t_n.get(), ctx.get())){
+            throw LocatedException(__FILE__, __LINE__, __FUNCTION__, -1, "BN_mod_mul failed");
+        }
+        a_bn_arr.push_back(a);
+        prefix_arr.push_back(prefix);
+    }
+
+    // inv = (a_0 * ... * a_{m-1})^{-1}
+    BIGNUM *inv = pool.New();
+    ERR_set_mark();
+    if(!BN_mod_inverse(inv, prefix_arr.back(), t_n.get(), ctx.get())){
+        ERR_pop_to_mark();
+        return false;
+    }
+    ERR_pop_to_mark();
+
+    // a_j^{-1} = inv * prefix_{j-1},  inv = inv * a_j
+    inv_arr.resize(a_arr.size());
+    ScopedBIGNUM t;
+    for(size_t j = a_arr.size() - 1; j > 0; j--){
+        if(!BN_mod_mul(t.get(), inv, prefix_arr[j - 1], t_n.get(), ctx.get()) ||
+           !BN_mod_mul(inv, inv, a_bn_arr[j], t_n.get(), ctx.get())){
+            throw LocatedException(__FILE__, __LINE__, __FUNCTION__, -1, "BN_mod_mul failed");
+        }
+        inv_arr[j] = t.ToBN();
+    }
+    if(!BN_copy(t.get(), inv)){
+        throw LocatedException(__FILE__, __LINE__, __FUNCTION__, -1, "BN_copy failed");
+    }
+    inv_arr[0] = t.ToBN();
+    return true;
+}
+
+BN MontContext::MulM(const safeheron::bignum::BN &a, const safeheron::bignum::BN &b) const {
+    ScopedBNCtx ctx;
+    ScopedBIGNUM t_a(a), t_b(b), t_n(n_), ret;
+    // a * R * b * R^{-1} = a * b  mod n
+    if(!BN_nnmod(t_a.get(), t_a.get(), t_n.get(), ctx.get()) ||
+       !BN_nnmod(t_b.get(), t_b.get(), t_n.get(), ctx.get()) ||
+       !BN_to_montgomery(t_a.get(), t_a.get(), mont_, ctx.get()) ||
+       !BN_mod_mul_montgomery(ret.get(), t_a.get(), t_b.get(), mont_, ctx.get())){
+        throw LocatedException(__FILE__, __LINE__, __FUNCTION__, -1, "BN_mod_mul_montgomery failed");
+    }
+    return ret.ToBN();
+}
+
+};
+};
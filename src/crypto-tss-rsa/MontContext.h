@@ -0,0 +1,118 @@
+#ifndef SAFEHERON_TSS_RSA_MONT_CONTEXT_H
+#define SAFEHERON_TSS_RSA_MONT_CONTEXT_H
+
+#include <cstdint>
+#include <vector>
+#include "crypto-bn/bn.h"
+
+struct bn_mont_ctx_st;
+
+namespace safeheron {
+namespace tss_rsa{
+
+/**
+ * Montgomery state of an odd modulus.
+ *
+ * Building the state costs about one modular reduction, so it pays off as soon as it is
+ * reused for more than one exponentiation with the same modulus.
+ * A MontContext is immutable after construction and may be shared between threads.
+ */
+class MontContext{
+public:
+    /**
+     * Constructor.
+     * @param[in] n an odd modulus
+     */
+    explicit MontContext(const safeheron::bignum::BN &n);
+
+    MontContext(const MontContext &other);
+    MontContext &operator=(const MontContext &other);
+    ~MontContext();
+
+    const bignum::BN &n() const;
+
+    /**
+     * Compute base^exp mod n. A negative exponent is handled by inverting the base.
+     * @note Not constant time. Only use it with public exponents.
+     * @param[in] base
+     * @param[in] exp
+     * @return base^exp mod n
+     */
+    safeheron::bignum::BN PowM(const safeheron::bignum::BN &base, const safeheron::bignum::BN &exp) const;
+
+    /**
+     * Compute base^exp mod n for a machine word exponent, such as the RSA public exponent 65537.
+     *
+     * It runs the left-to-right binary method directly on Montgomery products, so that 65537 costs
+     * 16 squarings and 1 multiplication.
+     * @note Not constant time. Only use it with public exponents.
+     * @param[in] base
+     * @param[in] exp
+     * @return base^exp mod n
+     */
+    safeheron::bignum::BN PowMWord(const safeheron::bignum::BN &base, uint64_t exp) const;
+
+    /**
+     * Compute base^exp mod n in constant time.
+     * @param[in] base
+     * @param[in] exp a secret exponent, exp >= 0
+     * @return base^exp mod n
+     */
+    safeheron::bignum::BN PowMSecret(const safeheron::bignum::BN &base, const safeheron::bignum::BN &exp) const;
+
+    /**
+     * Compute base_arr[0]^exp_arr[0] * ... * base_arr[k-1]^exp_arr[k-1] mod n.
+     *
+     * All the exponentiations share one chain of squarings (interleaved sliding windows,
+     * known as Straus' method or Shamir's trick), and the bases with negative exponents are
+     * accumulated apart so that only one modular inversion is needed.
+     * @note Not constant time. Only use it with public exponents.
+     * @param[in] base_arr
+     * @param[in] exp_arr
+     * @return the product of base_arr[i]^exp_arr[i] mod n
+     */
+    safeheron::bignum::BN MultiPowM(const std::vector<safeheron::bignum::BN> &base_arr,
+                                    const std::vector<safeheron::bignum::BN> &exp_arr) const;
+
+    /**
+     * Compute base^exp_arr[0], ..., base^exp_arr[m-1] mod n.
+     *
+     * The powers base^{2^{wt}} are computed once and shared by all the exponents (Yao's method),
+     * so m exponentiations of the same base cost about one chain of squarings plus
+     * m * (L/w + 2^w) multiplications, where L is the bit length of the exponents.
+     * @note Not constant time. Only use it with public exponents.
+     * @param[in] base
+     * @param[in] exp_arr exponents, exp_arr[j] >= 0
+     * @return base^exp_arr[j] mod n for each j
+     */
+    std::vector<safeheron::bignum::BN> BatchPowM(const safeheron::bignum::BN &base,
+                                                 const std::vector<safeheron::bignum::BN> &exp_arr) const;
+
+    /**
+     * Compute the inverses of all the elements with one modular inversion (Montgomery's trick).
+     * @param[in] a_arr
+     * @param[out] inv_arr a_arr[j]^{-1} mod n for each j
+     * @return true on success, false if some element is not invertible.
+     */
+    bool BatchInvM(const std::vector<safeheron::bignum::BN> &a_arr,
+                   std::vector<safeheron::bignum::BN> &inv_arr) const;
+
+    /**
+     * Compute a * b mod n.
+     * @param[in] a
+     * @param[in] b
+     * @return a * b mod n
+     */
+    safeheron::bignum::BN MulM(const safeheron::bignum::BN &a, const safeheron::bignum::BN &b) const;
+
+private:
+    friend class FixedBaseTable;
+
+    safeheron::bignum::BN n_;
+    bn_mont_ctx_st *mont_;
+};
+
+};
+};
+
+#endif //SAFEHERON_TSS_RSA_MONT_CONTEXT_H
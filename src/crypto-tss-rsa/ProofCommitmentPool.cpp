@@ -0,0 +1,195 @@
+#include "ProofCommitmentPool.h"
+#include <algorithm>
+#include <exception>
+#include <openssl/crypto.h>
+#include "crypto-bn/rand.h"
+#include "RSASigShareProof.h"
+
+using safeheron::bignum::BN;
+
+namespace safeheron {
+namespace tss_rsa{
+
+ProofCommitmentPool::ProofCommitmentPool(const RSAKeyMeta &key_meta,
+                                         const RSAPublicKey &public_key,
+                                         size_t capacity,
+                                         int thread_num)
+        : mont_n_(public_key.n()),
+          vkv_(key_meta.vkv()),
+          capacity_(capacity),
+          thread_num_(thread_num < 1 ? 1 : thread_num),
+          pending_num_(0),
+          generated_num_(0),
+          taken_num_(0),
+          miss_num_(0),
+          online_num_(0),
+          online_total_ns_(0),
+          online_max_ns_(0),
+          error_num_(0),
+          stop_(true),
+          start_time_(std::chrono::steady_clock::now()) {
+}
+
+ProofCommitmentPool::~ProofCommitmentPool() {
+    Stop();
+}
+
+const BN &ProofCommitmentPool::n() const {
+    return mont_n_.n();
+}
+
+const BN &ProofCommitmentPool::vkv() const {
+    return vkv_;
+}
+
+void ProofCommitmentPool::Start() {
+    std::lock_guard<std::mutex> control_lock(control_mutex_);
+    if(!thread_arr_.empty()) return;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_.store(false);
+        start_time_ = std::chrono::steady_clock::now();
+        generated_num_ = 0;
+    }
+    try {
+        for(int t = 0; t < thread_num_; t++){
+            thread_arr_.emplace_back(&ProofCommitmentPool::Run, this);
+        }
+    } catch (...) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_.store(true);
+        }
+        cv_.notify_all();
+        for(auto &t : thread_arr_) t.join();
+        thread_arr_.clear();
+        throw;
+    }
+}
+
+void ProofCommitmentPool::Stop() {
+    std::lock_guard<std::mutex> control_lock(control_mutex_);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_.store(true);
+    }
+    cv_.notify_all();
+    for(auto &t : thread_arr_) t.join();
+    thread_arr_.clear();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    ClearCommitments();
+}
+
+void ProofCommitmentPool::ClearCommitments() {
+    for(auto &commitment : commitment_arr_){
+        if(!commitment.r.empty()) OPENSSL_cleanse(&commitment.r[0], commitment.r.size());
+    }
+    commitment_arr_.clear();
+}
+
+ProofCommitmentPool::Commitment ProofCommitmentPool::Generate() const {
+    // r is uniform in [0, 2^(L(N) + 2*L1 + 1) )
+    const size_t r_bits = RSASigShareProof::RandomnessBits(mont_n_.n());
+    const size_t r_bytes = (r_bits + 7) / 8;
+    Commitment commitment;
+    commitment.r.assign(r_bytes, '\0');
+    safeheron::rand::RandomBytes((unsigned char *)&commitment.r[0], r_bytes);
+    commitment.r[0] = (char)(commitment.r[0] & (0xFF >> (r_bytes * 8 - r_bits)));
+    // v' = v^r
+    commitment.vp = mont_n_.PowMSecret(vkv_, BN::FromBytesBE(commitment.r));
+    return commitment;
+}
+
+void ProofCommitmentPool::Run() {
+    const std::chrono::milliseconds min_backoff(10);
+    const std::chrono::milliseconds max_backoff(1000);
+    std::chrono::milliseconds backoff(0);
+    while(true){
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            if(backoff.count() > 0){
+                cv_.wait_for(lock, backoff, [&]() { return stop_.load(); });
+            }
+            cv_.wait(lock, [&]() { return stop_.load() || commitment_arr_.size() + pending_num_ < capacity_; });
+            if(stop_.load()) return;
+            pending_num_++;
+        }
+
+        Commitment commitment;
+        std::string error;
+        try {
+            commitment = Generate();
+        } catch (const std::exception &e) {
+            error = e.what();
+        } catch (...) {
+            error = "unknown error";
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        pending_num_--;
+        if(error.empty()){
+            commitment_arr_.push_back(commitment);
+            generated_num_++;
+            backoff = std::chrono::milliseconds(0);
+        }else{
+            error_num_++;
+            last_error_ = error;
+            backoff = std::min(max_backoff, backoff.count() > 0 ? backoff * 2 : min_backoff);
+        }
+        if(!commitment.r.empty()) OPENSSL_cleanse(&commitment.r[0], commitment.r.size());
+    }
+}
+
+bool ProofCommitmentPool::TryTake(safeheron::bignum::BN &r, safeheron::bignum::BN &vp) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if(commitment_arr_.empty()){
+            miss_num_++;
+            return false;
+        }
+        Commitment &commitment = commitment_arr_.front();
+        r = BN::FromBytesBE(commitment.r);
+        vp = commitment.vp;
+        OPENSSL_cleanse(&commitment.r[0], commitment.r.size());
+        commitment_arr_.pop_front();
+        taken_num_++;
+    }
+    cv_.notify_one();
+    return true;
+}
+
+void ProofCommitmentPool::Take(safeheron::bignum::BN &r, safeheron::bignum::BN &vp) {
+    if(TryTake(r, vp)) return;
+    Commitment commitment = Generate();
+    r = BN::FromBytesBE(commitment.r);
+    vp = commitment.vp;
+    OPENSSL_cleanse(&commitment.r[0], commitment.r.size());
+}
+
+void ProofCommitmentPool::RecordOnlineLatency(std::chrono::nanoseconds latency) {
+    uint64_t ns = latency.count() > 0 ? (uint64_t)latency.count() : 0;
+    std::lock_guard<std::mutex> lock(mutex_);
+    online_num_++;
+    online_total_ns_ += ns;
+    online_max_ns_ = std::max(online_max_ns_, ns);
+}
+
+void ProofCommitmentPool::GetStat(ProofCommitmentPoolStat &stat) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stat.size = commitment_arr_.size();
+    stat.capacity = capacity_;
+    stat.generated_num = generated_num_;
+    stat.taken_num = taken_num_;
+    stat.miss_num = miss_num_;
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start_time_;
+    stat.refill_rate = elapsed.count() > 0 ? (double)generated_num_ / elapsed.count() : 0;
+    stat.online_num = online_num_;
+    stat.online_mean_us = online_num_ > 0 ? (double)online_total_ns_ / online_num_ / 1000 : 0;
+    stat.online_max_us = (double)online_max_ns_ / 1000;
+    stat.error_num = error_num_;
+    stat.last_error = last_error_;
+}
+
+};
+};
@@ -0,0 +1,162 @@
+#ifndef SAFEHERON_TSS_RSA_PROOF_COMMITMENT_POOL_H
+#define SAFEHERON_TSS_RSA_PROOF_COMMITMENT_POOL_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "crypto-bn/bn.h"
+#include "MontContext.h"
+#include "RSAKeyMeta.h"
+#include "RSAPublicKey.h"
+
+namespace safeheron {
+namespace tss_rsa{
+
+/**
+ * Metrics of a ProofCommitmentPool.
+ */
+struct ProofCommitmentPoolStat{
+    size_t size;             /**< number of commitments in the pool, the depth */
+    size_t capacity;         /**< maximum number of commitments in the pool */
+    uint64_t generated_num;  /**< number of commitments generated by the background threads */
+    uint64_t taken_num;      /**< number of commitments taken from the pool */
+    uint64_t miss_num;       /**< number of takes which found the pool empty */
+    double refill_rate;      /**< commitments generated per second since "Start" */
+    uint64_t online_num;     /**< number of online signings reported by "RecordOnlineLatency" */
+    double online_mean_us;   /**< mean latency of the online signings, in microseconds */
+    double online_max_us;    /**< maximum latency of the online signings, in microseconds */
+    uint64_t error_num;      /**< number of failed generations in the background threads */
+    std::string last_error;  /**< message of the last failed generation, empty if none */
+};
+
+/**
+ * Bounded pool of the offline part of the proofs of signature shares under a key.
+ *
+ * The randomness r of a proof and the commitment v' = vkv^r do not depend on the document, so the
+ * background threads compute pairs (r, v') ahead of time. "SigningContext::Sign" with a pool then
+ * only computes the signature share, x_tilde^r, the challenge and z.
+ *
+ * A pair is handed out once only: r is secret, and a proof made with a reused r reveals s_i.
+ * The pairs live in memory only, and r is wiped when the pool is stopped or destroyed.
+ *
+ * A background thread whose generation fails records the error in the metrics and waits before
+ * the next try, from 10 ms doubling up to 1 s, until a generation succeeds again.
+ *
+ * All the public methods are thread safe.
+ */
+class ProofCommitmentPool{
+public:
+    /**
+     * Constructor.
+     * @param[in] key_meta meta data of key
+     * @param[in] public_key public key
+     * @param[in] capacity maximum number of pairs in the pool.
+     * @param[in] thread_num number of background threads.
+     */
+    ProofCommitmentPool(const RSAKeyMeta &key_meta, const RSAPublicKey &public_key, size_t capacity, int thread_num);
+
+    /**
+     * Stop the background threads and wipe the pairs in the pool.
+     */
+    ~ProofCommitmentPool();
+
+    const safeheron::bignum::BN &n() const;
+
+    const safeheron::bignum::BN &vkv() const;
+
+    /**
+     * Start the background threads. Does nothing if they are running.
+     */
+    void Start();
+
+    /**
+     * Stop the background threads and wipe the pairs in the pool.
+     */
+    void Stop();
+
+    /**
+     * Take a pair from the pool, without waiting.
+     * @param[out] r secret randomness of a proof.
+     * @param[out] vp v' = vkv^r mod n
+     * @return true on success, false if the pool is empty.
+     */
+    bool TryTake(safeheron::bignum::BN &r, safeheron::bignum::BN &vp);
+
+    /**
+     * Take a pair from the pool, or generate it in the calling thread if the pool is empty.
+     * @param[out] r secret randomness of a proof.
+     * @param[out] vp v' = vkv^r mod n
+     */
+    void Take(safeheron::bignum::BN &r, safeheron::bignum::BN &vp);
+
+    /**
+     * Report the latency of an online signing, called by "SigningContext::Sign".
+     * @param[in] latency latency of the signing.
+     */
+    void RecordOnlineLatency(std::chrono::nanoseconds latency);
+
+    /**
+     * Get the metrics of the pool.
+     * @param[out] stat metrics.
+     */
+    void GetStat(ProofCommitmentPoolStat &stat) const;
+
+private:
+    ProofCommitmentPool(const ProofCommitmentPool &);
+    ProofCommitmentPool &operator=(const ProofCommitmentPool &);
+
+    /**
+     * A precomputed pair.
+     */
+    struct Commitment{
+        std::string r;  /**< r, big endian, kept as bytes so that it can be wiped */
+        safeheron::bignum::BN vp;
+    };
+
+    /**
+     * Generate a pair (r, vkv^r).
+     */
+    Commitment Generate() const;
+
+    /**
+     * Body of a background thread.
+     */
+    void Run();
+
+    /**
+     * Wipe r of every pair and empty the pool. Call it with mutex_ held.
+     */
+    void ClearCommitments();
+
+    MontContext mont_n_;  /**< Montgomery context of n */
+    safeheron::bignum::BN vkv_;  /**< validation key */
+    size_t capacity_;  /**< maximum number of pairs */
+    int thread_num_;  /**< number of background threads */
+    std::mutex control_mutex_;  /**< serializes "Start" and "Stop" */
+    mutable std::mutex mutex_;  /**< guards the pool and the metrics */
+    std::condition_variable cv_;  /**< notified when the pool has room or stops */
+    std::deque<Commitment> commitment_arr_;  /**< the pairs */
+    size_t pending_num_;  /**< number of pairs being generated */
+    uint64_t generated_num_;
+    uint64_t taken_num_;
+    uint64_t miss_num_;
+    uint64_t online_num_;
+    uint64_t online_total_ns_;
+    uint64_t online_max_ns_;
+    uint64_t error_num_;
+    std::string last_error_;
+    std::atomic<bool> stop_;  /**< set to stop the background threads */
+    std::chrono::steady_clock::time_point start_time_;  /**< time of the last "Start" */
+    std::vector<std::thread> thread_arr_;  /**< background threads */
+};
+
+};
+};
+
+#endif //SAFEHERON_TSS_RSA_PROOF_COMMITMENT_POOL_H
@@ -1,6 +1,8 @@
 #include "RSAKeyMeta.h"
+#include "binary_codec.h"
 #include <google/protobuf/util/json_util.h>
 #include "crypto-encode/base64.h"
+#include "RSASigShareProof.h"
 
 using std::string;
 using google::protobuf::util::Status;
@@ -47,6 +49,7 @@ const bignum::BN &RSAKeyMeta::vkv() const {
 
 void RSAKeyMeta::set_vkv(const bignum::BN &vkv) {
     vkv_ = vkv;
+    ClearFixedBaseTables();
 }
 
 const std::vector<safeheron::bignum::BN> &RSAKeyMeta::vki_arr() const {
@@ -54,8 +57,8 @@ const std::vector<safeheron::bignum::BN> &RSAKeyMeta::vki_arr() const {
 }
 
 void RSAKeyMeta::set_vki_arr(const std::vector<safeheron::bignum::BN> &vki_arr) {
-    this->vki_arr_.clear();
-    this->vki_arr_.insert(this->vki_arr_.begin(), vki_arr.begin(), vki_arr.end());
+    this->vki_arr_.assign(vki_arr.begin(), vki_arr.end());
+    ClearFixedBaseTables();
 }
 
 const safeheron::bignum::BN &RSAKeyMeta::vki(size_t index) const {
@@ -70,6 +73,52 @@ void RSAKeyMeta::set_vku(const bignum::BN &vku) {
     vku_ = vku;
 }
 
+bool RSAKeyMeta::BuildFixedBaseTables(const safeheron::bignum::BN &n, int h) {
+    ClearFixedBaseTables();
+    if(n <= 1 || !n.IsOdd() || h < 1 || h > 10) return false;
+    MontContext mont_n(n);
+
+    // The exponents of vkv are r and z = s_i * c + r, the ones of vki^{-1} are c.
+    std::vector<BN> vki_inv_arr;
+    if(!mont_n.BatchInvM(vki_arr_, vki_inv_arr)) return false;
+    std::shared_ptr<const FixedBaseTable> vkv_table =
+            std::make_shared<const FixedBaseTable>(mont_n, vkv_, RSASigShareProof::RandomnessBits(n) + 1, h);
+    std::vector<std::shared_ptr<const FixedBaseTable>> vki_inv_table_arr;
+    for(const auto &vki_inv : vki_inv_arr){
+        vki_inv_table_arr.push_back(std::make_shared<const FixedBaseTable>(mont_n, vki_inv, RSASigShareProof::ChallengeBits(), h));
+    }
+
+    vkv_table_ = vkv_table;
+    vki_inv_table_arr_ = vki_inv_table_arr;
+    return true;
+}
+
+void RSAKeyMeta::ClearFixedBaseTables() {
+    vkv_table_.reset();
+    vki_inv_table_arr_.clear();
+}
+
+std::shared_ptr<const FixedBaseTable> RSAKeyMeta::vkv_table() const {
+    return vkv_table_;
+}
+
+std::shared_ptr<const FixedBaseTable> RSAKeyMeta::vki_inv_table(size_t index) const {
+    if(index >= vki_inv_table_arr_.size()) return nullptr;
+    return vki_inv_table_arr_[index];
+}
+
+size_t RSAKeyMeta::FixedBaseTableMemorySize() const {
+    size_t size = vkv_table_ ? vkv_table_->MemorySize() : 0;
+    for(const auto &table : vki_inv_table_arr_){
+        size += table->MemorySize();
+    }
+    return size;
+}
+
+size_t RSAKeyMeta::FixedBaseTableMemorySize(size_t n_bits, int l, int h) {
+    return (size_t)(l + 1) * FixedBaseTable::MemorySize(n_bits, h);
+}
+
 bool RSAKeyMeta::ToProtoObject(proto::RSAKeyMeta &proof) const {
     bool ok = true;
 
@@ -96,6 +145,8 @@ bool RSAKeyMeta::ToProtoObject(proto::RSAKeyMeta &proof) const {
 bool RSAKeyMeta::FromProtoObject(const proto::RSAKeyMeta &proof) {
     bool ok = true;
 
+    ClearFixedBaseTables();
+
     k_ = proof.k();
     if(k_ == 0) return false;
 
@@ -106,10 +157,12 @@ bool RSAKeyMeta::FromProtoObject(const proto::RSAKeyMeta &proof) {
 
     vku_ = BN::FromHexStr(proof.vku());
 
+    std::vector<BN> vki_arr;
+    vki_arr.reserve(proof.vki_arr_size());
     for(int i = 0; i < proof.vki_arr_size(); ++i){
-        BN alpha = BN::FromHexStr(proof.vki_arr(i));
-        vki_arr_.push_back(alpha);
+        vki_arr.push_back(BN::FromHexStr(proof.vki_arr(i)));
     }
+    vki_arr_.swap(vki_arr);
     return true;
 }
 
@@ -166,5 +219,41 @@ bool TheClass::FromJsonString(const string &json_str) {
     return FromProtoObject(proto_object);
 }
 
+bool TheClass::ToBytes(string &bytes) const {
+    if(k_ < 2 || l_ < 2) return false;
+    BinaryWriter writer(BinaryType::KeyMeta);
+    writer.PutVarint((uint64_t)k_);
+    writer.PutVarint((uint64_t)l_);
+    if(!writer.PutBN(vkv_) || !writer.PutBN(vku_)) return false;
+    writer.PutVarint(vki_arr_.size());
+    for(const auto &vki : vki_arr_){
+        if(!writer.PutBN(vki)) return false;
+    }
+    writer.Swap(bytes);
+    return true;
+}
+
+bool TheClass::FromBytes(const string &bytes) {
+    BinaryReader reader(bytes, BinaryType::KeyMeta);
+    int k = 0, l = 0;
+    BN vkv, vku;
+    uint64_t count = 0;
+    if(!reader.GetInt(k) || !reader.GetInt(l) || !reader.GetBN(vkv) || !reader.GetBN(vku) || !reader.GetVarint(count)) return false;
+    if(k == 0 || l == 0 || count > bytes.size()) return false;
+    std::vector<BN> vki_arr((size_t)count);
+    for(auto &vki : vki_arr){
+        if(!reader.GetBN(vki)) return false;
+    }
+    if(!reader.Done()) return false;
+
+    ClearFixedBaseTables();
+    k_ = k;
+    l_ = l;
+    vkv_ = vkv;
+    vku_ = vku;
+    vki_arr_.swap(vki_arr);
+    return true;
+}
+
 };
 };
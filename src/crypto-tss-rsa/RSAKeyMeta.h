@@ -1,8 +1,10 @@
 #ifndef SAFEHERON_RSA_KEY_META_H
 #define SAFEHERON_RSA_KEY_META_H
 
+#include <memory>
 #include <vector>
 #include "crypto-bn/bn.h"
+#include "FixedBaseTable.h"
 #include "proto_gen/tss_rsa.pb.switch.h"
 
 namespace safeheron {
@@ -45,6 +47,51 @@ public:
     const bignum::BN &vku() const;
     void set_vku(const bignum::BN &vku);
 
+    /**
+     * Build and cache the fixed-base tables of vkv and of vki^{-1} of every party, see "FixedBaseTable".
+     *
+     * The table of vkv serves v^z and the table of vki^{-1} serves vki^{-c} in "RSASigShareProof::Verify".
+     * Signing doesn't use them: the exponent r of v^r is secret and the combs are not constant time. Copies of this object
+     * share the tables. Setting vkv or vki_arr, or deserializing, drops them.
+     * @param[in] n n = pq of the key.
+     * @param[in] h number of rows of the combs, 1 <= h <= 10. Each table takes 2^h elements of Z_n.
+     * @return true on success, false if n or a validation key is not valid.
+     */
+    bool BuildFixedBaseTables(const safeheron::bignum::BN &n, int h);
+
+    /**
+     * Drop the fixed-base tables.
+     */
+    void ClearFixedBaseTables();
+
+    /**
+     * Get the fixed-base table of vkv.
+     * @return the table, or null if the tables are not built.
+     */
+    std::shared_ptr<const FixedBaseTable> vkv_table() const;
+
+    /**
+     * Get the fixed-base table of vki^{-1} of party index + 1.
+     * @param[in] index index of the party minus 1.
+     * @return the table, or null if the tables are not built.
+     */
+    std::shared_ptr<const FixedBaseTable> vki_inv_table(size_t index) const;
+
+    /**
+     * Get the memory taken by the fixed-base tables of this key.
+     * @return size in bytes, 0 if the tables are not built.
+     */
+    size_t FixedBaseTableMemorySize() const;
+
+    /**
+     * Get the memory taken by the fixed-base tables of a key, before building them.
+     * @param[in] n_bits bit length of n.
+     * @param[in] l number of parties.
+     * @param[in] h number of rows of the combs.
+     * @return size in bytes, (l + 1) * 2^h * L(n) / 8 rounded up to 64-bit words.
+     */
+    static size_t FixedBaseTableMemorySize(size_t n_bits, int l, int h);
+
     /**
      * Convert this object into a protobuf object.
      * @param[out] proof
@@ -86,12 +133,28 @@ public:
      * @return true on success, false on error.
      */
     bool FromJsonString(const std::string &json_str);
+
+    /**
+     * Convert this object into the compact binary format (raw big-endian numbers, see binary_codec.h).
+     * @param[out] bytes
+     * @return true on success, false on error.
+     */
+    bool ToBytes(std::string &bytes) const;
+
+    /**
+     * Convert the compact binary format into this object.
+     * @param[in] bytes
+     * @return true on success, false on error.
+     */
+    bool FromBytes(const std::string &bytes);
 private:
     int k_;  /**< threshold */
     int l_;  /**< number of parties */
     safeheron::bignum::BN vkv_;  /**< validation key */
     std::vector<safeheron::bignum::BN> vki_arr_;  /**< validation key array of all parties */
     safeheron::bignum::BN vku_;  /**< safe parameter for protocol 2 */
+    std::shared_ptr<const FixedBaseTable> vkv_table_;  /**< fixed-base table of vkv, null if not built */
+    std::vector<std::shared_ptr<const FixedBaseTable>> vki_inv_table_arr_;  /**< fixed-base tables of vki^{-1} of all parties */
 
 };
 
@@ -0,0 +1,113 @@
+#include "RSAKeyMetaView.h"
+#include "binary_codec.h"
+#include "exception/located_exception.h"
+
+using safeheron::bignum::BN;
+using safeheron::exception::LocatedException;
+
+namespace safeheron {
+namespace tss_rsa{
+
+RSAKeyMetaView::RSAKeyMetaView()
+        : data_(nullptr),
+          k_(0),
+          l_(0) {
+}
+
+RSAKeyMetaView::RSAKeyMetaView(const RSAKeyMetaView &other) {
+    std::lock_guard<std::mutex> lock(other.mutex_);
+    data_ = other.data_;
+    k_ = other.k_;
+    l_ = other.l_;
+    vkv_ = other.vkv_;
+    vku_ = other.vku_;
+    vki_pos_arr_ = other.vki_pos_arr_;
+    vki_cache_ = other.vki_cache_;
+}
+
+bool RSAKeyMetaView::Load(const uint8_t *data, size_t size) {
+    if(!data) return false;
+    // The same layout as "RSAKeyMeta::FromBytes", but the validation keys are only located.
+    BinaryReader reader(data, size, BinaryType::KeyMeta);
+    int k = 0, l = 0;
+    BN vkv, vku;
+    uint64_t count = 0;
+    if(!reader.GetInt(k) || !reader.GetInt(l) || !reader.GetBN(vkv) || !reader.GetBN(vku) || !reader.GetVarint(count)) return false;
+    if(k == 0 || l == 0 || count > size) return false;
+    std::vector<std::pair<size_t, size_t>> vki_pos_arr((size_t)count);
+    for(auto &pos : vki_pos_arr){
+        if(!reader.SkipBN(pos.first, pos.second)) return false;
+    }
+    if(!reader.Done()) return false;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    data_ = data;
+    k_ = k;
+    l_ = l;
+    vkv_ = vkv;
+    vku_ = vku;
+    vki_pos_arr_.swap(vki_pos_arr);
+    vki_cache_.clear();
+    return true;
+}
+
+bool RSAKeyMetaView::Load(const std::string &bytes) {
+    return Load((const uint8_t *)bytes.data(), bytes.size());
+}
+
+int RSAKeyMetaView::k() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return k_;
+}
+
+int RSAKeyMetaView::l() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return l_;
+}
+
+BN RSAKeyMetaView::vkv() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return vkv_;
+}
+
+BN RSAKeyMetaView::vku() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return vku_;
+}
+
+size_t RSAKeyMetaView::vki_num() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return vki_pos_arr_.size();
+}
+
+BN RSAKeyMetaView::vki(size_t index) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if(index >= vki_pos_arr_.size()){
+        throw LocatedException(__FILE__, __LINE__, __FUNCTION__, -1, "index >= vki_num()");
+    }
+    auto iter = vki_cache_.find(index);
+    if(iter != vki_cache_.end()) return iter->second;
+    const std::pair<size_t, size_t> &pos = vki_pos_arr_[index];
+    BN vki = pos.second == 0 ? BN::ZERO : BN::FromBytesBE(data_ + pos.first, pos.second);
+    return vki_cache_.insert(std::make_pair(index, vki)).first->second;
+}
+
+size_t RSAKeyMetaView::CachedNum() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return vki_cache_.size();
+}
+
+bool RSAKeyMetaView::ToKeyMeta(RSAKeyMeta &key_meta) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if(!data_) return false;
+    std::vector<BN> vki_arr;
+    vki_arr.reserve(vki_pos_arr_.size());
+    for(const auto &pos : vki_pos_arr_){
+        vki_arr.push_back(pos.second == 0 ? BN::ZERO : BN::FromBytesBE(data_ + pos.first, pos.second));
+    }
+    key_meta = RSAKeyMeta(k_, l_, vkv_, vki_arr, vku_);
+    return true;
+}
+
+};
+};
@@ -0,0 +1,106 @@
+#ifndef SAFEHERON_RSA_KEY_META_VIEW_H
+#define SAFEHERON_RSA_KEY_META_VIEW_H
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "crypto-bn/bn.h"
+#include "RSAKeyMeta.h"
+
+namespace safeheron {
+namespace tss_rsa{
+
+/**
+ * Read-only view of a key meta data in the compact binary format (see "RSAKeyMeta::ToBytes").
+ *
+ * Loading only checks the layout of the buffer and decodes k, l, vkv and vku. The validation key
+ * vki of a party is decoded on its first use and then cached, so combining the shares of k parties
+ * decodes k validation keys instead of l.
+ *
+ * Only the binary format is covered. A key meta data in the protobuf, base64 or JSON formats is
+ * decoded with "RSAKeyMeta".
+ *
+ * The view does not copy the buffer, which must outlive the view and must not be modified.
+ * All the public methods are thread safe, and "Load" may run while other threads read the view:
+ * the state is swapped under the lock of the cache, and the getters return copies.
+ */
+class RSAKeyMetaView{
+public:
+    /**
+     * Constructor of an empty view.
+     */
+    RSAKeyMetaView();
+
+    RSAKeyMetaView(const RSAKeyMetaView &other);
+
+    /**
+     * Load a key meta data in the compact binary format.
+     * @param[in] data buffer, kept by the caller until the view is destroyed or loaded again.
+     * @param[in] size size of the buffer in bytes.
+     * @return true on success, false if the buffer is not a valid key meta data.
+     */
+    bool Load(const uint8_t *data, size_t size);
+
+    /**
+     * Load a key meta data in the compact binary format.
+     * @param[in] bytes buffer, kept by the caller until the view is destroyed or loaded again.
+     * @return true on success, false if the buffer is not a valid key meta data.
+     */
+    bool Load(const std::string &bytes);
+
+    /**
+     * A temporary buffer would not outlive the view.
+     */
+    bool Load(std::string &&bytes) = delete;
+
+    int k() const;
+
+    int l() const;
+
+    bignum::BN vkv() const;
+
+    bignum::BN vku() const;
+
+    /**
+     * Get the number of validation keys.
+     */
+    size_t vki_num() const;
+
+    /**
+     * Get the validation key of party index + 1, decoding it on the first use.
+     * @param[in] index index of the party minus 1.
+     * @return the validation key.
+     */
+    bignum::BN vki(size_t index) const;
+
+    /**
+     * Get the number of validation keys decoded so far.
+     */
+    size_t CachedNum() const;
+
+    /**
+     * Decode the whole key meta data.
+     * @param[out] key_meta
+     * @return true on success, false if the view is empty.
+     */
+    bool ToKeyMeta(RSAKeyMeta &key_meta) const;
+
+private:
+    RSAKeyMetaView &operator=(const RSAKeyMetaView &other);
+
+private:
+    const uint8_t *data_;  /**< buffer of the binary format, owned by the caller */
+    int k_;  /**< threshold */
+    int l_;  /**< number of parties */
+    safeheron::bignum::BN vkv_;  /**< validation key */
+    safeheron::bignum::BN vku_;  /**< safe parameter for protocol 2 */
+    std::vector<std::pair<size_t, size_t>> vki_pos_arr_;  /**< (offset, length) of vki of all parties in the buffer */
+    mutable std::mutex mutex_;  /**< guards all the members */
+    mutable std::map<size_t, safeheron::bignum::BN> vki_cache_;  /**< index => vki decoded so far */
+};
+
+};
+};
+
+#endif //SAFEHERON_RSA_KEY_META_VIEW_H
@@ -1,6 +1,8 @@
 #include "RSAPrivateKeyShare.h"
+#include "binary_codec.h"
 #include "RSASigShare.h"
 #include "RSASigShareProof.h"
+#include "SigningContext.h"
 #include "common.h"
 #include <google/protobuf/util/json_util.h>
 #include "crypto-encode/base64.h"
@@ -43,20 +45,7 @@ void RSAPrivateKeyShare::set_i(int i) {
 RSASigShare RSAPrivateKeyShare::InternalSign(const safeheron::bignum::BN &_x,
                                              const safeheron::tss_rsa::RSAKeyMeta &key_meta,
                                              const safeheron::tss_rsa::RSAPublicKey &public_key){
-    // x = x*u^e, if (m, n) == -1
-    BN x = _x;
-    if(BN::JacobiSymbol(x, public_key.n()) == -1){
-        x = (x * key_meta.vku().PowM(public_key.e(), public_key.n())) % public_key.n();
-    }
-
-    // x_i = x^{2 * s_i}
-    BN xi = x.PowM(si_ * 2, public_key.n());
-
-    RSASigShareProof proof;
-    proof.Prove(si_, key_meta.vkv(), key_meta.vki(i_-1), x, public_key.n(), xi);
-
-
-    return {i_, xi, proof.z(), proof.c()};
+    return SigningContext(*this, key_meta, public_key).InternalSign(_x);
 }
 
 RSASigShare RSAPrivateKeyShare::Sign(const std::string &doc,
@@ -66,6 +55,13 @@ RSASigShare RSAPrivateKeyShare::Sign(const std::string &doc,
     return InternalSign(x, key_meta, public_key);
 }
 
+std::vector<RSASigShare> RSAPrivateKeyShare::SignBatch(const std::vector<std::string> &doc_arr,
+                                                       const safeheron::tss_rsa::RSAKeyMeta &key_meta,
+                                                       const safeheron::tss_rsa::RSAPublicKey &public_key,
+                                                       int thread_num){
+    return SigningContext(*this, key_meta, public_key).SignBatch(doc_arr, thread_num);
+}
+
 bool RSAPrivateKeyShare::ToProtoObject(proto::RSAPrivateKeyShare &proof) const {
     bool ok = true;
 
@@ -143,5 +139,25 @@ bool TheClass::FromJsonString(const string &json_str) {
     return FromProtoObject(proto_object);
 }
 
+bool TheClass::ToBytes(string &bytes) const {
+    if(i_ <= 0) return false;
+    BinaryWriter writer(BinaryType::PrivateKeyShare);
+    writer.PutVarint((uint64_t)i_);
+    if(!writer.PutBN(si_)) return false;
+    writer.Swap(bytes);
+    return true;
+}
+
+bool TheClass::FromBytes(const string &bytes) {
+    BinaryReader reader(bytes, BinaryType::PrivateKeyShare);
+    int i = 0;
+    BN si;
+    if(!reader.GetInt(i) || !reader.GetBN(si) || !reader.Done()) return false;
+    if(i == 0) return false;
+    i_ = i;
+    si_ = si;
+    return true;
+}
+
 };
 };
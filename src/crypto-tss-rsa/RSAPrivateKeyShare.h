@@ -39,6 +39,21 @@ public:
                      const safeheron::tss_rsa::RSAKeyMeta &key_meta,
                      const safeheron::tss_rsa::RSAPublicKey &public_key);
 
+    /**
+     * Sign many messages and create their signature shares.
+     *
+     * The per-key context is prepared once and shared by all the messages. See "SigningContext::SignBatch".
+     * @param[in] doc_arr messages to sign.
+     * @param[in] key_meta meta data of key
+     * @param[in] public_key public key
+     * @param[in] thread_num number of threads, 1 to sign in the calling thread.
+     * @return the RSASigShare objects, in the order of doc_arr.
+     */
+    std::vector<RSASigShare> SignBatch(const std::vector<std::string> &doc_arr,
+                                       const safeheron::tss_rsa::RSAKeyMeta &key_meta,
+                                       const safeheron::tss_rsa::RSAPublicKey &public_key,
+                                       int thread_num);
+
     /**
      * Convert this object into a protobuf object.
      * @param[out] proof
@@ -81,6 +96,20 @@ public:
      */
     bool FromJsonString(const std::string &json_str);
 
+    /**
+     * Convert this object into the compact binary format (raw big-endian numbers, see binary_codec.h).
+     * @param[out] bytes
+     * @return true on success, false on error.
+     */
+    bool ToBytes(std::string &bytes) const;
+
+    /**
+     * Convert the compact binary format into this object.
+     * @param[in] bytes
+     * @return true on success, false on error.
+     */
+    bool FromBytes(const std::string &bytes);
+
 private:
     /**
      * Sign the message and create the signature share.
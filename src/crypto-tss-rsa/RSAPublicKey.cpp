@@ -1,4 +1,5 @@
 #include "RSAPublicKey.h"
+#include "binary_codec.h"
 #include "exception/safeheron_exceptions.h"
 #include <google/protobuf/util/json_util.h>
 #include "crypto-encode/base64.h"
@@ -25,24 +26,66 @@ namespace tss_rsa{
 RSAPublicKey::RSAPublicKey(const safeheron::bignum::BN &n, const safeheron::bignum::BN &e){
     this->n_ = n;
     this->e_ = e;
+    UpdateCache();
 }
 
-bool RSAPublicKey::InternalVerifySignature(const safeheron::bignum::BN &x, const safeheron::bignum::BN &sig) {
+void RSAPublicKey::UpdateCache() {
+    if(!(n_ > 1 && n_.IsOdd())){
+        mont_n_.reset();
+    }else if(!mont_n_ || mont_n_->n() != n_){
+        mont_n_ = std::make_shared<const MontContext>(n_);
+    }
+
+    e_word_ = 0;
+    if(e_ > 0 && e_.BitLength() <= 64){
+        string buf;
+        e_.ToBytesBE(buf);
+        for(unsigned char c : buf){
+            e_word_ = (e_word_ << 8) | c;
+        }
+    }
+}
+
+BN RSAPublicKey::PowE(const safeheron::bignum::BN &base) const {
+    if(!mont_n_) return base.PowM(e_, n_);
+    if(e_word_) return mont_n_->PowMWord(base, e_word_);
+    return mont_n_->PowM(base, e_);
+}
+
+bool RSAPublicKey::InternalVerifySignature(const safeheron::bignum::BN &x, const safeheron::bignum::BN &sig) const {
     // check y^e = x  mod n, where y = sig
-    return sig.PowM(e_, n_) == (x % n_);
+    return PowE(sig) == (x % n_);
 }
 
-bool RSAPublicKey::VerifySignature(const string &doc, const safeheron::bignum::BN &sig){
+bool RSAPublicKey::VerifySignature(const string &doc, const safeheron::bignum::BN &sig) const {
     BN x = BN::FromBytesBE(doc);
     return InternalVerifySignature(x, sig);
 }
 
+bool RSAPublicKey::VerifySignatureBatch(const std::vector<std::string> &doc_arr,
+                                        const std::vector<safeheron::bignum::BN> &sig_arr,
+                                        std::vector<size_t> &invalid_arr) const {
+    invalid_arr.clear();
+    if(doc_arr.size() != sig_arr.size()) return false;
+
+    std::vector<BN> x_arr;
+    for(const auto &doc : doc_arr){
+        x_arr.push_back(BN::FromBytesBE(doc) % n_);
+    }
+
+    for(size_t j = 0; j < sig_arr.size(); j++){
+        if(PowE(sig_arr[j]) != x_arr[j]) invalid_arr.push_back(j);
+    }
+    return invalid_arr.empty();
+}
+
 const bignum::BN &RSAPublicKey::n() const {
     return n_;
 }
 
 void RSAPublicKey::set_n(const bignum::BN &n) {
     n_ = n;
+    UpdateCache();
 }
 
 const bignum::BN &RSAPublicKey::e() const {
@@ -51,6 +94,7 @@ const bignum::BN &RSAPublicKey::e() const {
 
 void RSAPublicKey::set_e(const bignum::BN &e) {
     e_ = e;
+    UpdateCache();
 }
 
 bool RSAPublicKey::ToProtoObject(proto::RSAPublicKey &proof) const {
@@ -71,6 +115,7 @@ bool RSAPublicKey::FromProtoObject(const proto::RSAPublicKey &proof) {
 
     n_ = BN::FromHexStr(proof.n());
     e_ = BN::FromHexStr(proof.e());
+    UpdateCache();
 
     return true;
 }
@@ -128,6 +173,23 @@ bool TheClass::FromJsonString(const string &json_str) {
     return FromProtoObject(proto_object);
 }
 
+bool TheClass::ToBytes(string &bytes) const {
+    BinaryWriter writer(BinaryType::PublicKey);
+    if(!writer.PutBN(n_) || !writer.PutBN(e_)) return false;
+    writer.Swap(bytes);
+    return true;
+}
+
+bool TheClass::FromBytes(const string &bytes) {
+    BinaryReader reader(bytes, BinaryType::PublicKey);
+    BN n, e;
+    if(!reader.GetBN(n) || !reader.GetBN(e) || !reader.Done()) return false;
+    n_ = n;
+    e_ = e;
+    UpdateCache();
+    return true;
+}
+
 
 };
 };
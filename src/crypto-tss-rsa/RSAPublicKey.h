@@ -1,7 +1,12 @@
 #ifndef SAFEHERON_RSA_PUBLIC_KEY_H
 #define SAFEHERON_RSA_PUBLIC_KEY_H
 
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
 #include "crypto-bn/bn.h"
+#include "MontContext.h"
 #include "proto_gen/tss_rsa.pb.switch.h"
 
 
@@ -14,7 +19,7 @@ public:
     /**
      * Constructor.
      */
-    RSAPublicKey(){}
+    RSAPublicKey() : e_word_(0) {}
 
     /**
      * Constructor.
@@ -25,11 +30,28 @@ public:
 
     /**
      * Verify the signature.
+     *
+     * The Montgomery context of n is kept with the key, and an exponent e of at most 64 bits, such
+     * as 65537, is raised bit by bit on Montgomery products.
      * @param[in] doc
      * @param[in] sig
      * @return true on success, false on error.
      */
-    bool VerifySignature(const std::string &doc, const safeheron::bignum::BN &sig);
+    bool VerifySignature(const std::string &doc, const safeheron::bignum::BN &sig) const;
+
+    /**
+     * Verify many signatures under this key.
+     *
+     * Every signature is checked exactly, as "VerifySignature" does, and the positions of the
+     * invalid ones are reported.
+     * @param[in] doc_arr documents.
+     * @param[in] sig_arr sig_arr[j] is the signature of doc_arr[j].
+     * @param[out] invalid_arr positions of the invalid signatures.
+     * @return true if all the signatures are valid, false otherwise.
+     */
+    bool VerifySignatureBatch(const std::vector<std::string> &doc_arr,
+                              const std::vector<safeheron::bignum::BN> &sig_arr,
+                              std::vector<size_t> &invalid_arr) const;
 
     const bignum::BN &n() const;
     void set_n(const bignum::BN &n);
@@ -79,6 +101,20 @@ public:
      */
     bool FromJsonString(const std::string &json_str);
 
+    /**
+     * Convert this object into the compact binary format (raw big-endian numbers, see binary_codec.h).
+     * @param[out] bytes
+     * @return true on success, false on error.
+     */
+    bool ToBytes(std::string &bytes) const;
+
+    /**
+     * Convert the compact binary format into this object.
+     * @param[in] bytes
+     * @return true on success, false on error.
+     */
+    bool FromBytes(const std::string &bytes);
+
 private:
     /**
      * Verify the signature.
@@ -86,10 +122,22 @@ private:
      * @param[in] sig
      * @return true on success, false on error.
      */
-    bool InternalVerifySignature(const safeheron::bignum::BN &x, const safeheron::bignum::BN &sig);
+    bool InternalVerifySignature(const safeheron::bignum::BN &x, const safeheron::bignum::BN &sig) const;
+
+    /**
+     * Compute base^e mod n.
+     */
+    safeheron::bignum::BN PowE(const safeheron::bignum::BN &base) const;
+
+    /**
+     * Rebuild the cached values after n or e changed.
+     */
+    void UpdateCache();
 private:
     safeheron::bignum::BN n_;
     safeheron::bignum::BN e_;
+    std::shared_ptr<const MontContext> mont_n_;  /**< Montgomery context of n, null if n is not a valid odd modulus */
+    uint64_t e_word_;  /**< e if 0 < e < 2^64, 0 otherwise */
 };
 
 
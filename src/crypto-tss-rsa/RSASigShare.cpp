@@ -1,4 +1,5 @@
 #include "RSASigShare.h"
+#include "binary_codec.h"
 #include <google/protobuf/util/json_util.h>
 #include "crypto-encode/base64.h"
 
@@ -144,5 +145,27 @@ bool TheClass::FromJsonString(const string &json_str) {
     return FromProtoObject(proto_object);
 }
 
+bool TheClass::ToBytes(string &bytes) const {
+    if(index_ <= 0) return false;
+    BinaryWriter writer(BinaryType::SigShare);
+    writer.PutVarint((uint64_t)index_);
+    if(!writer.PutBN(sig_share_) || !writer.PutBN(z_) || !writer.PutBN(c_)) return false;
+    writer.Swap(bytes);
+    return true;
+}
+
+bool TheClass::FromBytes(const string &bytes) {
+    BinaryReader reader(bytes, BinaryType::SigShare);
+    int index = 0;
+    BN sig_share, z, c;
+    if(!reader.GetInt(index) || !reader.GetBN(sig_share) || !reader.GetBN(z) || !reader.GetBN(c) || !reader.Done()) return false;
+    if(index == 0) return false;
+    index_ = index;
+    sig_share_ = sig_share;
+    z_ = z;
+    c_ = c;
+    return true;
+}
+
 };
 };
@@ -80,6 +80,20 @@ public:
      * @return true on success, false on error.
      */
     bool FromJsonString(const std::string &json_str);
+
+    /**
+     * Convert this object into the compact binary format (raw big-endian numbers, see binary_codec.h).
+     * @param[out] bytes
+     * @return true on success, false on error.
+     */
+    bool ToBytes(std::string &bytes) const;
+
+    /**
+     * Convert the compact binary format into this object.
+     * @param[in] bytes
+     * @return true on success, false on error.
+     */
+    bool FromBytes(const std::string &bytes);
 private:
     int index_;  /**< index of party */
     safeheron::bignum::BN sig_share_;  /**< signature share */
@@ -1,4 +1,5 @@
 #include "RSASigShareProof.h"
+#include "binary_codec.h"
 #include <cassert>
 #include <google/protobuf/util/json_util.h>
 #include "exception/safeheron_exceptions.h"
@@ -45,36 +46,85 @@ void RSASigShareProof::set_c(const bignum::BN &c) {
     c_ = c;
 }
 
+safeheron::bignum::BN RSASigShareProof::Challenge(const safeheron::bignum::BN &v,
+                                                  const safeheron::bignum::BN &x_tilde,
+                                                  const safeheron::bignum::BN &vi,
+                                                  const safeheron::bignum::BN &sig2,
+                                                  const safeheron::bignum::BN &vp,
+                                                  const safeheron::bignum::BN &xp){
+    uint8_t digest[CSHA256::OUTPUT_SIZE];
+    CSHA256 sha256;
+    std::string buf;
+    v.ToBytesBE(buf);         sha256.Write((const uint8_t *)buf.c_str(), buf.size());
+    x_tilde.ToBytesBE(buf);   sha256.Write((const uint8_t *)buf.c_str(), buf.size());
+    vi.ToBytesBE(buf);        sha256.Write((const uint8_t *)buf.c_str(), buf.size());
+    sig2.ToBytesBE(buf);      sha256.Write((const uint8_t *)buf.c_str(), buf.size());
+    vp.ToBytesBE(buf);        sha256.Write((const uint8_t *)buf.c_str(), buf.size());
+    xp.ToBytesBE(buf);        sha256.Write((const uint8_t *)buf.c_str(), buf.size());
+    sha256.Finalize(digest);
+    return BN::FromBytesBE(digest, CSHA256::OUTPUT_SIZE);
+}
+
 void RSASigShareProof::Prove(const safeheron::bignum::BN &si,
                              const safeheron::bignum::BN &v,
                              const safeheron::bignum::BN &vi,
                              const safeheron::bignum::BN &x,
                              const safeheron::bignum::BN &n,
                              const safeheron::bignum::BN &sig_i){
+    Prove(si, v, vi, x, MontContext(n), sig_i);
+}
+
+void RSASigShareProof::Prove(const safeheron::bignum::BN &si,
+                             const safeheron::bignum::BN &v,
+                             const safeheron::bignum::BN &vi,
+                             const safeheron::bignum::BN &x,
+                             const MontContext &mont_n,
+                             const safeheron::bignum::BN &sig_i){
+    const BN &n = mont_n.n();
     // sample random r in (0, 2^(L(N) + 2*L1 + 1) )
     BN upper_bound = BN::TWO << (n.BitLength() + L1 * 2);
     BN r = safeheron::rand::RandomBNLt(upper_bound);
+    Prove(si, v, vi, x, mont_n, sig_i, r);
+}
+
+size_t RSASigShareProof::RandomnessBits(const safeheron::bignum::BN &n){
+    return n.BitLength() + L1 * 2 + 1;
+}
+
+size_t RSASigShareProof::ChallengeBits(){
+    return L1;
+}
+
+void RSASigShareProof::Prove(const safeheron::bignum::BN &si,
+                             const safeheron::bignum::BN &v,
+                             const safeheron::bignum::BN &vi,
+                             const safeheron::bignum::BN &x,
+                             const MontContext &mont_n,
+                             const safeheron::bignum::BN &sig_i,
+                             const safeheron::bignum::BN &r){
     // v' = v^r
-    BN vp = v.PowM(r, n);
+    BN vp = mont_n.PowMSecret(v, r);
     // x_tilde = x^4
-    BN x_tilde = x.PowM(BN::FOUR, n);
+    BN x_tilde = mont_n.PowM(x, BN::FOUR);
     // x' = x_tilde^r
-    BN xp = x_tilde.PowM(r, n);
+    BN xp = mont_n.PowMSecret(x_tilde, r);
+    ProveWithCommitment(si, v, vi, x_tilde, mont_n, sig_i, r, vp, xp);
+}
+
+void RSASigShareProof::ProveWithCommitment(const safeheron::bignum::BN &si,
+                                           const safeheron::bignum::BN &v,
+                                           const safeheron::bignum::BN &vi,
+                                           const safeheron::bignum::BN &x_tilde,
+                                           const MontContext &mont_n,
+                                           const safeheron::bignum::BN &sig_i,
+                                           const safeheron::bignum::BN &r,
+                                           const safeheron::bignum::BN &vp,
+                                           const safeheron::bignum::BN &xp){
     // sig^2
-    BN sig2 = sig_i.PowM(BN::TWO, n);
+    BN sig2 = mont_n.MulM(sig_i, sig_i);
 
     // c = H(v, x_tilde, vi, x^2, v', x')
-    uint8_t digest[CSHA256::OUTPUT_SIZE];
-    CSHA256 sha256;
-    std::string buf;
-    v.ToBytesBE(buf);         sha256.Write((const uint8_t *)buf.c_str(), buf.size());
-    x_tilde.ToBytesBE(buf);   sha256.Write((const uint8_t *)buf.c_str(), buf.size());
-    vi.ToBytesBE(buf);        sha256.Write((const uint8_t *)buf.c_str(), buf.size());
-    sig2.ToBytesBE(buf);      sha256.Write((const uint8_t *)buf.c_str(), buf.size());
-    vp.ToBytesBE(buf);        sha256.Write((const uint8_t *)buf.c_str(), buf.size());
-    xp.ToBytesBE(buf);        sha256.Write((const uint8_t *)buf.c_str(), buf.size());
-    sha256.Finalize(digest);
-    BN c = BN::FromBytesBE(digest, CSHA256::OUTPUT_SIZE);
+    BN c = Challenge(v, x_tilde, vi, sig2, vp, xp);
 
     // z = si * c + r
     BN z = si * c + r;
@@ -88,27 +138,47 @@ bool RSASigShareProof::Verify(const safeheron::bignum::BN &v,
                               const safeheron::bignum::BN &x,
                               const safeheron::bignum::BN &n,
                               const safeheron::bignum::BN &sig_i){
+    return Verify(v, vi, x, MontContext(n), sig_i);
+}
+
+bool RSASigShareProof::Verify(const safeheron::bignum::BN &v,
+                              const safeheron::bignum::BN &vi,
+                              const safeheron::bignum::BN &x,
+                              const MontContext &mont_n,
+                              const safeheron::bignum::BN &sig_i){
     // v' = v^z * vi^(-c)  mod n
-    BN vp = ( v.PowM(z_, n) * vi.PowM(c_ * (-1), n) ) % n;
+    BN vp = mont_n.MultiPowM({v, vi}, {z_, c_ * (-1)});
     // x_tilde = x^4  mod n
-    BN x_tilde = x.PowM(BN::FOUR, n);
+    BN x_tilde = mont_n.PowM(x, BN::FOUR);
     // x' = x_tilde^z * x^(-2c)  mod n
-    BN xp = ( x_tilde.PowM(z_, n) * sig_i.PowM(c_ * (-2), n) ) % n;
+    BN xp = mont_n.MultiPowM({x_tilde, sig_i}, {z_, c_ * (-2)});
     // sig^2  mod n
-    BN sig2 = sig_i.PowM(BN::TWO, n);
+    BN sig2 = mont_n.MulM(sig_i, sig_i);
 
     // c = H(v, x_tilde, vi, x^2, v', x')
-    uint8_t digest[CSHA256::OUTPUT_SIZE];
-    CSHA256 sha256;
-    std::string buf;
-    v.ToBytesBE(buf);         sha256.Write((const uint8_t *)buf.c_str(), buf.size());
-    x_tilde.ToBytesBE(buf);   sha256.Write((const uint8_t *)buf.c_str(), buf.size());
-    vi.ToBytesBE(buf);        sha256.Write((const uint8_t *)buf.c_str(), buf.size());
-    sig2.ToBytesBE(buf);      sha256.Write((const uint8_t *)buf.c_str(), buf.size());
-    vp.ToBytesBE(buf);        sha256.Write((const uint8_t *)buf.c_str(), buf.size());
-    xp.ToBytesBE(buf);        sha256.Write((const uint8_t *)buf.c_str(), buf.size());
-    sha256.Finalize(digest);
-    BN c = BN::FromBytesBE(digest, CSHA256::OUTPUT_SIZE);
+    BN c = Challenge(v, x_tilde, vi, sig2, vp, xp);
+
+    // check c == c_
+    return c == c_;
+}
+
+bool RSASigShareProof::Verify(const FixedBaseTable &vkv_table,
+                              const FixedBaseTable &vki_inv_table,
+                              const safeheron::bignum::BN &vi,
+                              const safeheron::bignum::BN &x,
+                              const safeheron::bignum::BN &sig_i){
+    const MontContext &mont_n = vkv_table.mont_n();
+    // v' = v^z * vi^(-c)  mod n
+    BN vp = mont_n.MulM(vkv_table.PowM(z_), vki_inv_table.PowM(c_));
+    // x_tilde = x^4  mod n
+    BN x_tilde = mont_n.PowM(x, BN::FOUR);
+    // x' = x_tilde^z * x^(-2c)  mod n
+    BN xp = mont_n.MultiPowM({x_tilde, sig_i}, {z_, c_ * (-2)});
+    // sig^2  mod n
+    BN sig2 = mont_n.MulM(sig_i, sig_i);
+
+    // c = H(v, x_tilde, vi, x^2, v', x')
+    BN c = Challenge(vkv_table.base(), x_tilde, vi, sig2, vp, xp);
 
     // check c == c_
     return c == c_;
@@ -189,6 +259,22 @@ bool TheClass::FromJsonString(const string &json_str) {
     return FromProtoObject(proto_object);
 }
 
+bool TheClass::ToBytes(string &bytes) const {
+    BinaryWriter writer(BinaryType::SigShareProof);
+    if(!writer.PutBN(z_) || !writer.PutBN(c_)) return false;
+    writer.Swap(bytes);
+    return true;
+}
+
+bool TheClass::FromBytes(const string &bytes) {
+    BinaryReader reader(bytes, BinaryType::SigShareProof);
+    BN z, c;
+    if(!reader.GetBN(z) || !reader.GetBN(c) || !reader.Done()) return false;
+    z_ = z;
+    c_ = c;
+    return true;
+}
+
 
 }
 }
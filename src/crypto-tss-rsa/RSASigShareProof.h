@@ -2,6 +2,8 @@
 #define SAFEHERON_RSA_SIGNATURE_SHARE_PROOF_H
 
 #include "crypto-bn/bn.h"
+#include "FixedBaseTable.h"
+#include "MontContext.h"
 #include "proto_gen/tss_rsa.pb.switch.h"
 
 
@@ -46,6 +48,75 @@ public:
                const safeheron::bignum::BN &n,
                const safeheron::bignum::BN &sig_i);
 
+    /**
+     * Create a proof of the signature share with a prepared Montgomery context of n.
+     * @param[in] si secret share of party i
+     * @param[in] vkv validation key
+     * @param[in] vki validation key of party i
+     * @param[in] x x which represents the message
+     * @param[in] mont_n Montgomery context of n = pq
+     * @param[in] sig_i signature share of party i
+     */
+    void Prove(const safeheron::bignum::BN &si,
+               const safeheron::bignum::BN &vkv,
+               const safeheron::bignum::BN &vki,
+               const safeheron::bignum::BN &x,
+               const MontContext &mont_n,
+               const safeheron::bignum::BN &sig_i);
+
+    /**
+     * Create a proof of the signature share with a prepared Montgomery context of n and given randomness.
+     * @param[in] si secret share of party i
+     * @param[in] vkv validation key
+     * @param[in] vki validation key of party i
+     * @param[in] x x which represents the message
+     * @param[in] mont_n Montgomery context of n = pq
+     * @param[in] sig_i signature share of party i
+     * @param[in] r secret randomness of the proof, uniform in [0, 2^RandomnessBits(n)). Never reuse it.
+     */
+    void Prove(const safeheron::bignum::BN &si,
+               const safeheron::bignum::BN &vkv,
+               const safeheron::bignum::BN &vki,
+               const safeheron::bignum::BN &x,
+               const MontContext &mont_n,
+               const safeheron::bignum::BN &sig_i,
+               const safeheron::bignum::BN &r);
+
+    /**
+     * Create a proof of the signature share from its commitments, computed by the caller.
+     * @param[in] si secret share of party i
+     * @param[in] vkv validation key
+     * @param[in] vki validation key of party i
+     * @param[in] x_tilde x^4 mod n, where x represents the message
+     * @param[in] mont_n Montgomery context of n = pq
+     * @param[in] sig_i signature share of party i
+     * @param[in] r secret randomness of the proof, see the overload above.
+     * @param[in] vp v' = vkv^r mod n
+     * @param[in] xp x' = x_tilde^r mod n
+     */
+    void ProveWithCommitment(const safeheron::bignum::BN &si,
+                             const safeheron::bignum::BN &vkv,
+                             const safeheron::bignum::BN &vki,
+                             const safeheron::bignum::BN &x_tilde,
+                             const MontContext &mont_n,
+                             const safeheron::bignum::BN &sig_i,
+                             const safeheron::bignum::BN &r,
+                             const safeheron::bignum::BN &vp,
+                             const safeheron::bignum::BN &xp);
+
+    /**
+     * Get the bit length of the randomness of a proof.
+     * @param[in] n n = pq
+     * @return L(n) + 2 * L1 + 1, where L1 is the output length of the hash.
+     */
+    static size_t RandomnessBits(const safeheron::bignum::BN &n);
+
+    /**
+     * Get the maximum bit length of the challenge c.
+     * @return L1, the output length of the hash.
+     */
+    static size_t ChallengeBits();
+
     /**
      * Verify the proof of the signature share.
      * @param[in] vkv validation key
@@ -61,6 +132,56 @@ public:
                 const safeheron::bignum::BN &n,
                 const safeheron::bignum::BN &sig_i);
 
+    /**
+     * Verify the proof of the signature share with a prepared Montgomery context of n.
+     * @param[in] vkv validation key
+     * @param[in] vki validation key of party i
+     * @param[in] x x which represents the message
+     * @param[in] mont_n Montgomery context of n = pq
+     * @param[in] sig_i signature share of party i
+     * @return true on success, false on error.
+     */
+    bool Verify(const safeheron::bignum::BN &vkv,
+                const safeheron::bignum::BN &vki,
+                const safeheron::bignum::BN &x,
+                const MontContext &mont_n,
+                const safeheron::bignum::BN &sig_i);
+
+    /**
+     * Verify the proof of the signature share with the fixed-base tables of vkv and vki^{-1}, see
+     * "RSAKeyMeta::BuildFixedBaseTables".
+     * @param[in] vkv_table fixed-base table of the validation key, which holds the Montgomery context of n = pq
+     * @param[in] vki_inv_table fixed-base table of the inverse of the validation key of party i
+     * @param[in] vki validation key of party i
+     * @param[in] x x which represents the message
+     * @param[in] sig_i signature share of party i
+     * @return true on success, false on error.
+     */
+    bool Verify(const FixedBaseTable &vkv_table,
+                const FixedBaseTable &vki_inv_table,
+                const safeheron::bignum::BN &vki,
+                const safeheron::bignum::BN &x,
+                const safeheron::bignum::BN &sig_i);
+
+    /**
+     * Compute the challenge of the proof.
+     *
+     * $$ c = H(v, \tilde{x}, v_i, x_i^2, v', x') $$
+     * @param[in] v validation key
+     * @param[in] x_tilde x^4 mod n
+     * @param[in] vi validation key of party i
+     * @param[in] sig2 sig_i^2 mod n
+     * @param[in] vp v' = v^r mod n
+     * @param[in] xp x' = x_tilde^r mod n
+     * @return the challenge c
+     */
+    static safeheron::bignum::BN Challenge(const safeheron::bignum::BN &v,
+                                           const safeheron::bignum::BN &x_tilde,
+                                           const safeheron::bignum::BN &vi,
+                                           const safeheron::bignum::BN &sig2,
+                                           const safeheron::bignum::BN &vp,
+                                           const safeheron::bignum::BN &xp);
+
     /**
      * Convert this object into a protobuf object.
      * @param[out] proof
@@ -102,6 +223,20 @@ public:
      * @return true on success, false on error.
      */
     bool FromJsonString(const std::string &json_str);
+
+    /**
+     * Convert this object into the compact binary format (raw big-endian numbers, see binary_codec.h).
+     * @param[out] bytes
+     * @return true on success, false on error.
+     */
+    bool ToBytes(std::string &bytes) const;
+
+    /**
+     * Convert the compact binary format into this object.
+     * @param[in] bytes
+     * @return true on success, false on error.
+     */
+    bool FromBytes(const std::string &bytes);
 private:
     safeheron::bignum::BN z_;
     safeheron::bignum::BN c_;
@@ -0,0 +1,389 @@
+#include "SafePrimePool.h"
+#include <algorithm>
+#include <cstdio>
+#include <exception>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <openssl/crypto.h>
+#include <openssl/evp.h>
+#include "crypto-bn/rand.h"
+#include "exception/located_exception.h"
+#include "safe_prime.h"
+
+using safeheron::bignum::BN;
+using safeheron::exception::LocatedException;
+
+namespace safeheron {
+namespace tss_rsa{
+
+namespace {
+
+const char FILE_MAGIC[] = "TSSRSASP";
+const size_t FILE_MAGIC_SIZE = 8;
+const size_t GCM_KEY_SIZE = 32;
+const size_t GCM_NONCE_SIZE = 12;
+const size_t GCM_TAG_SIZE = 16;
+
+struct CipherCtxDeleter{
+    void operator()(EVP_CIPHER_CTX *ctx) const { EVP_CIPHER_CTX_free(ctx); }
+};
+typedef std::unique_ptr<EVP_CIPHER_CTX, CipherCtxDeleter> CipherCtxPtr;
+
+void PutUint32(std::string &buf, uint32_t v) {
+    for(int shift = 24; shift >= 0; shift -= 8){
+        buf.push_back((char)((v >> shift) & 0xFF));
+    }
+}
+
+bool GetUint32(const std::string &buf, size_t &pos, uint32_t &v) {
+    if(buf.size() < pos + 4) return false;
+    v = 0;
+    for(int t = 0; t < 4; t++){
+        v = (v << 8) | (unsigned char)buf[pos + t];
+    }
+    pos += 4;
+    return true;
+}
+
+/**
+ * AES-256-GCM encryption, the magic is authenticated as additional data.
+ */
+bool Seal(const std::string &key, const std::string &plain, std::string &out) {
+    unsigned char nonce[GCM_NONCE_SIZE];
+    unsigned char tag[GCM_TAG_SIZE];
+    safeheron::rand::RandomBytes(nonce, GCM_NONCE_SIZE);
+    std::string cipher(plain.size(), '\0');
+    CipherCtxPtr ctx(EVP_CIPHER_CTX_new());
+    int len = 0;
+    if(!ctx ||
+       !EVP_EncryptInit_ex(ctx.get(), EVP_aes_256_gcm(), nullptr, nullptr, nullptr) ||
+       !EVP_CIPHER_CTX_ctrl(ctx.get(), EVP_CTRL_GCM_SET_IVLEN, (int)GCM_NONCE_SIZE, nullptr) ||
+       !EVP_EncryptInit_ex(ctx.get(), nullptr, nullptr, (const unsigned char *)key.data(), nonce) ||
+       !EVP_EncryptUpdate(ctx.get(), nullptr, &len, (const unsigned char *)FILE_MAGIC, (int)FILE_MAGIC_SIZE) ||
+       !EVP_EncryptUpdate(ctx.get(), (unsigned char *)&cipher[0], &len, (const unsigned char *)plain.data(), (int)plain.size()) ||
+       !EVP_EncryptFinal_ex(ctx.get(), (unsigned char *)&cipher[0] + len, &len) ||
+       !EVP_CIPHER_CTX_ctrl(ctx.get(), EVP_CTRL_GCM_GET_TAG, (int)GCM_TAG_SIZE, tag)){
+        return false;
+    }
+    out.assign(FILE_MAGIC, FILE_MAGIC_SIZE);
+    out.append((const char *)nonce, GCM_NONCE_SIZE);
+    out.append((const char *)tag, GCM_TAG_SIZE);
+    out.append(cipher);
+    return true;
+}
+
+/**
+ * AES-256-GCM decryption, fails if the data doesn't pass authentication.
+ */
+bool Open(const std::string &key, const std::string &data, std::string &plain) {
+    const size_t header_size = FILE_MAGIC_SIZE + GCM_NONCE_SIZE + GCM_TAG_SIZE;
+    if(data.size() < header_size || data.compare(0, FILE_MAGIC_SIZE, FILE_MAGIC, FILE_MAGIC_SIZE) != 0){
+        return false;
+    }
+    const unsigned char *nonce = (const unsigned char *)data.data() + FILE_MAGIC_SIZE;
+    unsigned char tag[GCM_TAG_SIZE];
+    std::copy(data.begin() + FILE_MAGIC_SIZE + GCM_NONCE_SIZE, data.begin() + header_size, tag);
+    plain.assign(data.size() - header_size, '\0');
+    CipherCtxPtr ctx(EVP_CIPHER_CTX_new());
+    int len = 0;
+    if(!ctx ||
+       !EVP_DecryptInit_ex(ctx.get(), EVP_aes_256_gcm(), nullptr, nullptr, nullptr) ||
+       !EVP_CIPHER_CTX_ctrl(ctx.get(), EVP_CTRL_GCM_SET_IVLEN, (int)GCM_NONCE_SIZE, nullptr) ||
+       !EVP_DecryptInit_ex(ctx.get(), nullptr, nullptr, (const unsigned char *)key.data(), nonce) ||
+       !EVP_DecryptUpdate(ctx.get(), nullptr, &len, (const unsigned char *)FILE_MAGIC, (int)FILE_MAGIC_SIZE) ||
+       !EVP_DecryptUpdate(ctx.get(), (unsigned char *)&plain[0], &len, (const unsigned char *)data.data() + header_size, (int)plain.size()) ||
+       !EVP_CIPHER_CTX_ctrl(ctx.get(), EVP_CTRL_GCM_SET_TAG, (int)GCM_TAG_SIZE, tag) ||
+       EVP_DecryptFinal_ex(ctx.get(), (unsigned char *)&plain[0] + len, &len) <= 0){
+        if(!plain.empty()) OPENSSL_cleanse(&plain[0], plain.size());
+        plain.clear();
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Append a safe prime as bits (4 bytes) || length (4 bytes) || p.
+ */
+void PutEntry(std::string &plain, size_t bits, const BN &p) {
+    std::string buf;
+    p.ToBytesBE(buf);
+    PutUint32(plain, (uint32_t)bits);
+    PutUint32(plain, (uint32_t)buf.size());
+    plain.append(buf);
+    if(!buf.empty()) OPENSSL_cleanse(&buf[0], buf.size());
+}
+
+/**
+ * Encrypt "plain" and write it to a temporary file which then replaces "path", so that a failed
+ * write leaves the old file in place.
+ */
+bool WriteSealed(const std::string &path, const std::string &key, const std::string &plain) {
+    std::string data;
+    if(!Seal(key, plain, data)) return false;
+    const std::string tmp_path = path + ".tmp";
+    bool ok;
+    {
+        std::ofstream out(tmp_path, std::ios::binary | std::ios::trunc);
+        ok = out.write(data.data(), (std::streamsize)data.size()) && out.flush();
+    }
+    if(ok) ok = std::rename(tmp_path.c_str(), path.c_str()) == 0;
+    if(!ok) std::remove(tmp_path.c_str());
+    return ok;
+}
+
+}
+
+SafePrimePool::SafePrimePool(const std::vector<size_t> &bits_arr, size_t capacity, int thread_num)
+        : capacity_(capacity),
+          thread_num_(thread_num < 1 ? 1 : thread_num),
+          error_num_(0),
+          stop_(true),
+          start_time_(std::chrono::steady_clock::now()) {
+    for(size_t bits : bits_arr){
+        // The sieve rejects shorter safe primes, the background threads would only fail on them.
+        if(bits < 16){
+            throw LocatedException(__FILE__, __LINE__, __FUNCTION__, -1, "bits < 16");
+        }
+        queue_map_[bits];
+    }
+}
+
+SafePrimePool::~SafePrimePool() {
+    Stop();
+}
+
+void SafePrimePool::Start() {
+    std::lock_guard<std::mutex> control_lock(control_mutex_);
+    if(!thread_arr_.empty()) return;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_.store(false);
+        start_time_ = std::chrono::steady_clock::now();
+        for(auto &item : queue_map_){
+            item.second.generated_num = 0;
+        }
+    }
+    try {
+        for(int t = 0; t < thread_num_; t++){
+            thread_arr_.emplace_back(&SafePrimePool::Run, this);
+        }
+    } catch (...) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_.store(true);
+        }
+        cv_.notify_all();
+        for(auto &t : thread_arr_) t.join();
+        thread_arr_.clear();
+        throw;
+    }
+}
+
+void SafePrimePool::Stop() {
+    std::lock_guard<std::mutex> control_lock(control_mutex_);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_.store(true);
+    }
+    cv_.notify_all();
+    for(auto &t : thread_arr_) t.join();
+    thread_arr_.clear();
+}
+
+bool SafePrimePool::PickQueue(size_t &bits) const {
+    bool found = false;
+    size_t min_fill = 0;
+    for(const auto &item : queue_map_){
+        size_t fill = item.second.prime_arr.size() + item.second.pending_num;
+        if(fill >= capacity_) continue;
+        if(!found || fill < min_fill){
+            found = true;
+            min_fill = fill;
+            bits = item.first;
+        }
+    }
+    return found;
+}
+
+void SafePrimePool::Run() {
+    const std::chrono::milliseconds min_backoff(10);
+    const std::chrono::milliseconds max_backoff(1000);
+    std::chrono::milliseconds backoff(0);
+    while(true){
+        size_t bits = 0;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            if(backoff.count() > 0){
+                cv_.wait_for(lock, backoff, [&]() { return stop_.load(); });
+            }
+            cv_.wait(lock, [&]() { return stop_.load() || PickQueue(bits); });
+            if(stop_.load()) return;
+            queue_map_[bits].pending_num++;
+        }
+
+        BN p;
+        bool ok = false;
+        std::string error;
+        try {
+            ok = GenerateSafePrime(bits, DefaultSafePrimeSieveParam(bits), stop_, p);
+        } catch (const std::exception &e) {
+            error = e.what();
+        } catch (...) {
+            error = "unknown error";
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        Queue &queue = queue_map_[bits];
+        queue.pending_num--;
+        if(ok){
+            queue.prime_arr.push_back(p);
+            queue.generated_num++;
+            backoff = std::chrono::milliseconds(0);
+        }else if(!error.empty()){
+            // A search stopped by "Stop" is not an error.
+            error_num_++;
+            last_error_ = error;
+            backoff = std::min(max_backoff, backoff.count() > 0 ? backoff * 2 : min_backoff);
+        }
+    }
+}
+
+bool SafePrimePool::TryTake(size_t bits, safeheron::bignum::BN &p) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = queue_map_.find(bits);
+        if(it == queue_map_.end()) return false;
+        Queue &queue = it->second;
+        if(queue.prime_arr.empty()){
+            queue.miss_num++;
+            return false;
+        }
+        p = queue.prime_arr.front();
+        queue.prime_arr.pop_front();
+        queue.taken_num++;
+    }
+    cv_.notify_one();
+    return true;
+}
+
+BN SafePrimePool::Take(size_t bits) {
+    BN p;
+    if(TryTake(bits, p)) return p;
+    return GenerateSafePrime(bits, 1);
+}
+
+bool SafePrimePool::GetStat(size_t bits, SafePrimePoolStat &stat) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = queue_map_.find(bits);
+    if(it == queue_map_.end()) return false;
+    const Queue &queue = it->second;
+    stat.size = queue.prime_arr.size();
+    stat.capacity = capacity_;
+    stat.generated_num = queue.generated_num;
+    stat.taken_num = queue.taken_num;
+    stat.miss_num = queue.miss_num;
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start_time_;
+    stat.refill_rate = elapsed.count() > 0 ? (double)queue.generated_num / elapsed.count() : 0;
+    stat.error_num = error_num_;
+    stat.last_error = last_error_;
+    return true;
+}
+
+bool SafePrimePool::SaveToFile(const std::string &path, const std::string &key) {
+    if(key.size() != GCM_KEY_SIZE) return false;
+
+    // Move the safe primes out of the queues.
+    std::map<size_t, std::deque<BN>> saved_map;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for(auto &item : queue_map_){
+            saved_map[item.first].swap(item.second.prime_arr);
+        }
+    }
+    cv_.notify_all();
+
+    std::string plain;
+    for(const auto &item : saved_map){
+        for(const auto &p : item.second){
+            PutEntry(plain, item.first, p);
+        }
+    }
+    bool ok = WriteSealed(path, key, plain);
+    if(!plain.empty()) OPENSSL_cleanse(&plain[0], plain.size());
+
+    if(!ok){
+        // Put the safe primes back.
+        std::lock_guard<std::mutex> lock(mutex_);
+        for(auto &item : saved_map){
+            std::deque<BN> &prime_arr = queue_map_[item.first].prime_arr;
+            prime_arr.insert(prime_arr.end(), item.second.begin(), item.second.end());
+        }
+    }
+    return ok;
+}
+
+bool SafePrimePool::LoadFromFile(const std::string &path, const std::string &key) {
+    if(key.size() != GCM_KEY_SIZE) return false;
+
+    std::string data;
+    {
+        std::ifstream in(path, std::ios::binary);
+        if(!in) return false;
+        data.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+    std::string plain;
+    if(!Open(key, data, plain)) return false;
+
+    std::vector<std::pair<size_t, BN>> loaded_arr;
+    size_t pos = 0;
+    bool ok = true;
+    while(ok && pos < plain.size()){
+        uint32_t bits = 0;
+        uint32_t len = 0;
+        ok = GetUint32(plain, pos, bits) && GetUint32(plain, pos, len) && plain.size() >= pos + len;
+        if(ok){
+            loaded_arr.emplace_back(bits, BN::FromBytesBE((const uint8_t *)plain.data() + pos, len));
+            pos += len;
+        }
+    }
+    if(!plain.empty()) OPENSSL_cleanse(&plain[0], plain.size());
+    if(!ok) return false;
+
+    // Take what fits in the queues, counting the searches in progress, and keep the rest in the
+    // file. The lock is held until the file is updated, so that a safe prime is never both in the
+    // pool and in the file.
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::map<size_t, size_t> room_map;
+    for(const auto &item : queue_map_){
+        size_t fill = item.second.prime_arr.size() + item.second.pending_num;
+        room_map[item.first] = fill < capacity_ ? capacity_ - fill : 0;
+    }
+    std::vector<const std::pair<size_t, BN> *> accepted_arr;
+    std::string left_plain;
+    for(const auto &item : loaded_arr){
+        auto it = room_map.find(item.first);
+        if(it != room_map.end() && it->second > 0){
+            it->second--;
+            accepted_arr.push_back(&item);
+        }else{
+            PutEntry(left_plain, item.first, item.second);
+        }
+    }
+
+    if(left_plain.empty()){
+        ok = std::remove(path.c_str()) == 0;
+    }else{
+        ok = WriteSealed(path, key, left_plain);
+        OPENSSL_cleanse(&left_plain[0], left_plain.size());
+    }
+    if(!ok) return false;
+
+    for(const auto *item : accepted_arr){
+        queue_map_[item->first].prime_arr.push_back(item->second);
+    }
+    return true;
+}
+
+};
+};
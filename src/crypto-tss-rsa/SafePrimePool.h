@@ -0,0 +1,165 @@
+#ifndef SAFEHERON_TSS_RSA_SAFE_PRIME_POOL_H
+#define SAFEHERON_TSS_RSA_SAFE_PRIME_POOL_H
+
+#ifdef SAFEHERON_TSS_RSA_SGX
+#error "SafePrimePool needs threads and files, it is not part of the SGX build"
+#endif
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "crypto-bn/bn.h"
+
+namespace safeheron {
+namespace tss_rsa{
+
+/**
+ * Metrics of the queue of one bit length.
+ */
+struct SafePrimePoolStat{
+    size_t size;             /**< number of safe primes in the queue, the fill level */
+    size_t capacity;         /**< maximum number of safe primes in the queue */
+    uint64_t generated_num;  /**< number of safe primes generated by the background threads */
+    uint64_t taken_num;      /**< number of safe primes taken from the queue */
+    uint64_t miss_num;       /**< number of takes which found the queue empty */
+    double refill_rate;      /**< safe primes generated per second since the pool was started */
+    uint64_t error_num;      /**< number of failed searches in the background threads, for all the queues */
+    std::string last_error;  /**< message of the last failed search, empty if none */
+};
+
+/**
+ * Bounded queues of pre-generated safe primes, one queue per bit length.
+ *
+ * After "Start" the background threads keep every queue full, refilling the emptiest one first.
+ * "Take" then returns a safe prime at once, so that key generation only has to do the arithmetic.
+ * Each safe prime is handed out once only.
+ *
+ * The content may be saved to a file encrypted with AES-256-GCM and loaded back later, to keep the
+ * pre-generated safe primes across restarts. Saving moves the safe primes out of the pool, and
+ * loading removes the loaded ones from the file, so that a safe prime is never used by two keys.
+ *
+ * A background thread whose search fails records the error in the metrics and waits before the
+ * next try, from 10 ms doubling up to 1 s, until a search succeeds again.
+ *
+ * All the public methods are thread safe.
+ */
+class SafePrimePool{
+public:
+    /**
+     * Constructor.
+     * @param[in] bits_arr bit lengths of the safe primes to pool, at least 16 each. A 2t-bit key of
+     *            "GenerateKey" uses safe primes of t and t - 1 bits.
+     * @param[in] capacity maximum number of safe primes per bit length.
+     * @param[in] thread_num number of background threads.
+     */
+    SafePrimePool(const std::vector<size_t> &bits_arr, size_t capacity, int thread_num);
+
+    /**
+     * Stop the background threads.
+     */
+    ~SafePrimePool();
+
+    /**
+     * Start the background threads. Does nothing if they are running.
+     */
+    void Start();
+
+    /**
+     * Stop the background threads, the safe primes in the queues are kept.
+     * A thread in the middle of a search stops after its current candidate.
+     */
+    void Stop();
+
+    /**
+     * Take a safe prime of "bits" bits from the queue, without waiting.
+     * @param[in] bits bit length.
+     * @param[out] p a safe prime.
+     * @return true on success, false if the queue is empty or "bits" is not pooled.
+     */
+    bool TryTake(size_t bits, safeheron::bignum::BN &p);
+
+    /**
+     * Take a safe prime of "bits" bits from the queue, or generate it in the calling thread if the
+     * queue is empty.
+     * @param[in] bits bit length.
+     * @return a safe prime.
+     */
+    safeheron::bignum::BN Take(size_t bits);
+
+    /**
+     * Get the metrics of the queue of "bits" bits.
+     * @param[in] bits bit length.
+     * @param[out] stat metrics.
+     * @return true on success, false if "bits" is not pooled.
+     */
+    bool GetStat(size_t bits, SafePrimePoolStat &stat) const;
+
+    /**
+     * Move all the safe primes of the pool into an encrypted file.
+     * @param[in] path file path.
+     * @param[in] key 32-byte AES-256-GCM key.
+     * @return true on success. On failure the safe primes stay in the pool.
+     */
+    bool SaveToFile(const std::string &path, const std::string &key);
+
+    /**
+     * Load the safe primes of an encrypted file into the pool, as many as fit in the capacity.
+     * The file is deleted if all of them are loaded, otherwise it is rewritten with the rest,
+     * including the safe primes of a bit length which is not pooled.
+     * @param[in] path file path.
+     * @param[in] key 32-byte AES-256-GCM key.
+     * @return true on success, false if the file can't be read or fails authentication.
+     */
+    bool LoadFromFile(const std::string &path, const std::string &key);
+
+private:
+    SafePrimePool(const SafePrimePool &);
+    SafePrimePool &operator=(const SafePrimePool &);
+
+    /**
+     * Queue of one bit length.
+     */
+    struct Queue{
+        std::deque<safeheron::bignum::BN> prime_arr;
+        size_t pending_num = 0;  /**< number of searches in progress */
+        uint64_t generated_num = 0;
+        uint64_t taken_num = 0;
+        uint64_t miss_num = 0;
+    };
+
+    /**
+     * Body of a background thread.
+     */
+    void Run();
+
+    /**
+     * Pick the queue with the lowest fill level which is not full. Call it with mutex_ held.
+     * @param[out] bits bit length of the queue.
+     * @return false if all the queues are full.
+     */
+    bool PickQueue(size_t &bits) const;
+
+    size_t capacity_;  /**< maximum number of safe primes per bit length */
+    int thread_num_;  /**< number of background threads */
+    std::mutex control_mutex_;  /**< serializes "Start" and "Stop" */
+    mutable std::mutex mutex_;  /**< guards queue_map_, the error metrics and start_time_ */
+    std::condition_variable cv_;  /**< notified when a queue has room or the pool stops */
+    std::map<size_t, Queue> queue_map_;  /**< bit length => queue */
+    uint64_t error_num_;  /**< number of failed searches */
+    std::string last_error_;  /**< message of the last failed search */
+    std::atomic<bool> stop_;  /**< set to stop the background threads */
+    std::vector<std::thread> thread_arr_;  /**< background threads */
+    std::chrono::steady_clock::time_point start_time_;  /**< time of "Start" */
+};
+
+};
+};
+
+#endif //SAFEHERON_TSS_RSA_SAFE_PRIME_POOL_H
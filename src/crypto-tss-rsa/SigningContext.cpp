@@ -0,0 +1,151 @@
+#include "SigningContext.h"
+#include <chrono>
+#include <openssl/crypto.h>
+#include "exception/safeheron_exceptions.h"
+#include "crypto-bn/rand.h"
+#include "RSASigShareProof.h"
+#include "parallel.h"
+
+using safeheron::bignum::BN;
+using safeheron::exception::LocatedException;
+
+namespace safeheron {
+namespace tss_rsa{
+
+SigningContext::SigningContext(const RSAPrivateKeyShare &private_key_share,
+                               const RSAKeyMeta &key_meta,
+                               const RSAPublicKey &public_key)
+        : i_(private_key_share.i()),
+          si_(private_key_share.si()),
+          si2_(private_key_share.si() * 2),
+          vkv_(key_meta.vkv()),
+          vki_(key_meta.vki(private_key_share.i() - 1)),
+          mont_n_(public_key.n()) {
+    vku_e_ = mont_n_.PowM(key_meta.vku(), public_key.e());
+}
+
+int SigningContext::i() const {
+    return i_;
+}
+
+const MontContext &SigningContext::mont_n() const {
+    return mont_n_;
+}
+
+BN SigningContext::PrepareMessage(const safeheron::bignum::BN &_x) const {
+    // x = x*u^e, if (m, n) == -1
+    BN x = _x;
+    if(BN::JacobiSymbol(x, mont_n_.n()) == -1){
+        x = mont_n_.MulM(x, vku_e_);
+    }
+    return x;
+}
+
+RSASigShare SigningContext::InternalSign(const safeheron::bignum::BN &_x, const safeheron::bignum::BN &r) const {
+    BN x = PrepareMessage(_x);
+
+    // x_i = x^{2 * s_i}
+    BN xi = mont_n_.PowMSecret(x, si2_);
+
+    // v' = v^r
+    BN vp = mont_n_.PowMSecret(vkv_, r);
+    // x_tilde = x^4
+    BN x_tilde = mont_n_.PowM(x, BN::FOUR);
+    // x' = x_tilde^r
+    BN xp = mont_n_.PowMSecret(x_tilde, r);
+
+    RSASigShareProof proof;
+    proof.ProveWithCommitment(si_, vkv_, vki_, x_tilde, mont_n_, xi, r, vp, xp);
+
+    return {i_, xi, proof.z(), proof.c()};
+}
+
+RSASigShare SigningContext::InternalSign(const safeheron::bignum::BN &x) const {
+    // sample random r in (0, 2^(L(N) + 2*L1 + 1) )
+    BN r = safeheron::rand::RandomBNLt(BN::ONE << RSASigShareProof::RandomnessBits(mont_n_.n()));
+    return InternalSign(x, r);
+}
+
+RSASigShare SigningContext::Sign(const std::string &doc) const {
+    BN x = BN::FromBytesBE(doc);
+    return InternalSign(x);
+}
+
+#ifndef SAFEHERON_TSS_RSA_SGX
+RSASigShare SigningContext::Sign(const std::string &doc, ProofCommitmentPool &pool) const {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    if(pool.n() != mont_n_.n() || pool.vkv() != vkv_){
+        throw LocatedException(__FILE__, __LINE__, __FUNCTION__, -1, "pool.n() != n || pool.vkv() != vkv");
+    }
+
+    BN x = PrepareMessage(BN::FromBytesBE(doc));
+
+    // r and v' = v^r, computed offline
+    BN r, vp;
+    pool.Take(r, vp);
+
+    // x_i = x^{2 * s_i}
+    BN xi = mont_n_.PowMSecret(x, si2_);
+    // x_tilde = x^4
+    BN x_tilde = mont_n_.PowM(x, BN::FOUR);
+    // x' = x_tilde^r
+    BN xp = mont_n_.PowMSecret(x_tilde, r);
+
+    RSASigShareProof proof;
+    proof.ProveWithCommitment(si_, vkv_, vki_, x_tilde, mont_n_, xi, r, vp, xp);
+
+    pool.RecordOnlineLatency(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start));
+    return {i_, xi, proof.z(), proof.c()};
+}
+#endif
+
+RSASigShare SigningContext::SignLowLatency(const std::string &doc) const {
+    BN x = PrepareMessage(BN::FromBytesBE(doc));
+    // sample random r in (0, 2^(L(N) + 2*L1 + 1) )
+    BN r = safeheron::rand::RandomBNLt(BN::ONE << RSASigShareProof::RandomnessBits(mont_n_.n()));
+    // x_tilde = x^4
+    BN x_tilde = mont_n_.PowM(x, BN::FOUR);
+
+    // x_i = x^{2 * s_i}, v' = v^r, x' = x_tilde^r
+    BN xi, vp, xp;
+    ParallelFor(3, 3, [&](size_t j) {
+        if(j == 0){
+            xi = mont_n_.PowMSecret(x, si2_);
+        }else if(j == 1){
+            vp = mont_n_.PowMSecret(vkv_, r);
+        }else{
+            xp = mont_n_.PowMSecret(x_tilde, r);
+        }
+    });
+
+    RSASigShareProof proof;
+    proof.ProveWithCommitment(si_, vkv_, vki_, x_tilde, mont_n_, xi, r, vp, xp);
+
+    return {i_, xi, proof.z(), proof.c()};
+}
+
+std::vector<RSASigShare> SigningContext::SignBatch(const std::vector<std::string> &doc_arr, int thread_num) const {
+    // Draw the randomness of all the proofs at once, r_j is uniform in [0, 2^r_bits).
+    const size_t r_bits = RSASigShareProof::RandomnessBits(mont_n_.n());
+    const size_t r_bytes = (r_bits + 7) / 8;
+    std::vector<BN> r_arr;
+    {
+        std::string buf(r_bytes * doc_arr.size(), '\0');
+        if(!buf.empty()) safeheron::rand::RandomBytes((unsigned char *)&buf[0], buf.size());
+        for(size_t j = 0; j < doc_arr.size(); j++){
+            unsigned char *chunk = (unsigned char *)&buf[j * r_bytes];
+            chunk[0] &= (unsigned char)(0xFF >> (r_bytes * 8 - r_bits));
+            r_arr.push_back(BN::FromBytesBE(chunk, r_bytes));
+        }
+        if(!buf.empty()) OPENSSL_cleanse(&buf[0], buf.size());
+    }
+
+    std::vector<RSASigShare> sig_arr(doc_arr.size());
+    ParallelFor(doc_arr.size(), thread_num, [&](size_t j) {
+        sig_arr[j] = InternalSign(BN::FromBytesBE(doc_arr[j]), r_arr[j]);
+    });
+    return sig_arr;
+}
+
+};
+};
@@ -0,0 +1,128 @@
+#ifndef SAFEHERON_TSS_RSA_SIGNING_CONTEXT_H
+#define SAFEHERON_TSS_RSA_SIGNING_CONTEXT_H
+
+#include <string>
+#include <vector>
+#include "crypto-bn/bn.h"
+#include "MontContext.h"
+#ifndef SAFEHERON_TSS_RSA_SGX
+#include "ProofCommitmentPool.h"
+#endif
+#include "RSAKeyMeta.h"
+#include "RSAPrivateKeyShare.h"
+#include "RSAPublicKey.h"
+#include "RSASigShare.h"
+
+namespace safeheron {
+namespace tss_rsa{
+
+/**
+ * Per-key signing context of party i.
+ *
+ * Everything that depends only on the key (vku^e mod n, the Montgomery context of n, 2 * s_i
+ * and the validation keys) is computed once in the constructor, so that "Sign" only does the
+ * work that depends on the message.
+ * Sign is const and the context may be shared between threads.
+ */
+class SigningContext{
+public:
+    /**
+     * Constructor.
+     * @param[in] private_key_share private key share of party i
+     * @param[in] key_meta meta data of key
+     * @param[in] public_key public key
+     */
+    SigningContext(const RSAPrivateKeyShare &private_key_share,
+                   const RSAKeyMeta &key_meta,
+                   const RSAPublicKey &public_key);
+
+    int i() const;
+
+    const MontContext &mont_n() const;
+
+    /**
+     * Sign the message and create the signature share.
+     * @param[in] doc message to sign.
+     * @return a RSASigShare object.
+     */
+    RSASigShare Sign(const std::string &doc) const;
+
+#ifndef SAFEHERON_TSS_RSA_SGX
+    /**
+     * Sign the message and create the signature share, with the randomness of the proof and v^r
+     * taken from a pool filled offline.
+     *
+     * Only x^{2s_i}, (x^4)^r, the challenge and z are computed here. If the pool is empty, the pair
+     * is generated in the calling thread. The latency of the call is reported to the pool.
+     * @param[in] doc message to sign.
+     * @param[in] pool pool of the key of this context.
+     * @return a RSASigShare object.
+     */
+    RSASigShare Sign(const std::string &doc, ProofCommitmentPool &pool) const;
+#endif
+
+    /**
+     * Sign many messages and create their signature shares.
+     *
+     * The randomness of all the proofs is drawn from the random source at once, and the messages
+     * are spread over thread_num threads.
+     * @param[in] doc_arr messages to sign.
+     * @param[in] thread_num number of threads, 1 to sign in the calling thread.
+     * @return the RSASigShare objects, in the order of doc_arr.
+     */
+    std::vector<RSASigShare> SignBatch(const std::vector<std::string> &doc_arr, int thread_num) const;
+
+    /**
+     * Sign the message and create the signature share with less latency than "Sign".
+     *
+     * The signature share x^{2s_i} and the two commitments of the proof, v^r and (x^4)^r, are
+     * independent exponentiations of about L(n) bits each, so they run on three threads. The
+     * result has the same distribution as the one of "Sign"; only the wall time changes, while the
+     * total CPU time is slightly higher because of the threads.
+     *
+     * Shorter exponentiations would need data from the dealer, and none is safe to hand out:
+     *   - p and q, for CRT, reveal the factorization of n, and then d to any single party.
+     *   - m = p'q', to reduce the exponents, reveals p' + q' = (n - 1) / 2 - 2m, and so p and q.
+     *   - s_i is fixed by the sharing polynomial mod m, and r must be L(n) + 2 * L1 bits so that
+     *     z = s_i * c + r hides s_i statistically, so neither can be shortened.
+     * @param[in] doc message to sign.
+     * @return a RSASigShare object.
+     */
+    RSASigShare SignLowLatency(const std::string &doc) const;
+
+    /**
+     * Sign the message and create the signature share.
+     * @param[in] x a BN object which indicate the message to sign.
+     * @return a RSASigShare object.
+     */
+    RSASigShare InternalSign(const safeheron::bignum::BN &x) const;
+
+private:
+    /**
+     * Map the message into Z_n^* with Jacobi symbol 1.
+     * @param[in] x a BN object which indicate the message to sign.
+     * @return x if jacobi(x, n) != -1, x * vku^e otherwise.
+     */
+    safeheron::bignum::BN PrepareMessage(const safeheron::bignum::BN &x) const;
+
+    /**
+     * Sign the message and create the signature share with given randomness of the proof.
+     * @param[in] x a BN object which indicate the message to sign.
+     * @param[in] r randomness of the proof.
+     * @return a RSASigShare object.
+     */
+    RSASigShare InternalSign(const safeheron::bignum::BN &x, const safeheron::bignum::BN &r) const;
+
+    int i_;   /**< index of party. */
+    safeheron::bignum::BN si_;  /**< secret share of party i. */
+    safeheron::bignum::BN si2_;  /**< 2 * s_i */
+    safeheron::bignum::BN vkv_;  /**< validation key */
+    safeheron::bignum::BN vki_;  /**< validation key of party i */
+    safeheron::bignum::BN vku_e_;  /**< vku^e mod n */
+    MontContext mont_n_;  /**< Montgomery context of n */
+};
+
+};
+};
+
+#endif //SAFEHERON_TSS_RSA_SIGNING_CONTEXT_H
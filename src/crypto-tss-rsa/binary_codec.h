@@ -0,0 +1,165 @@
+#ifndef SAFEHERON_TSS_RSA_BINARY_CODEC_H
+#define SAFEHERON_TSS_RSA_BINARY_CODEC_H
+
+#include <climits>
+#include <cstdint>
+#include <string>
+#include <openssl/crypto.h>
+#include "crypto-bn/bn.h"
+
+namespace safeheron {
+namespace tss_rsa{
+
+/**
+ * Compact binary format of "ToBytes" / "FromBytes" (version 2; version 1 is the hex-string protobuf format).
+ *
+ *     version (1 byte, 0x02) || type (1 byte) || fields
+ *
+ * An integer is an unsigned LEB128 varint. A BN is the varint byte length followed by the big-endian
+ * magnitude, without leading zeros (0 has length 0); negative numbers are not encoded. An array is the
+ * varint count followed by the items.
+ */
+const uint8_t BINARY_FORMAT_VERSION = 0x02;
+
+/**
+ * Type byte of each serialized class.
+ */
+enum class BinaryType : uint8_t {
+    PublicKey = 1,
+    PrivateKeyShare = 2,
+    KeyMeta = 3,
+    SigShare = 4,
+    SigShareProof = 5
+};
+
+class BinaryWriter{
+public:
+    explicit BinaryWriter(BinaryType type) {
+        buf_.push_back((char)BINARY_FORMAT_VERSION);
+        buf_.push_back((char)type);
+    }
+
+    void PutVarint(uint64_t v) {
+        while(v >= 0x80){
+            buf_.push_back((char)((v & 0x7F) | 0x80));
+            v >>= 7;
+        }
+        buf_.push_back((char)v);
+    }
+
+    /**
+     * @return false if num is negative.
+     */
+    bool PutBN(const safeheron::bignum::BN &num) {
+        if(num.IsNeg()) return false;
+        if(num.IsZero()){
+            PutVarint(0);
+            return true;
+        }
+        std::string tmp;
+        num.ToBytesBE(tmp);
+        PutVarint(tmp.size());
+        buf_.append(tmp);
+        // The number may be a secret share.
+        OPENSSL_cleanse(&tmp[0], tmp.size());
+        return true;
+    }
+
+    /**
+     * Move the result out of the writer.
+     */
+    void Swap(std::string &out) {
+        out.swap(buf_);
+    }
+
+private:
+    std::string buf_;
+};
+
+class BinaryReader{
+public:
+    /**
+     * Check the header, "ok" is false if the version or the type don't match.
+     */
+    BinaryReader(const std::string &bytes, BinaryType type)
+            : BinaryReader((const uint8_t *)bytes.data(), bytes.size(), type) {
+    }
+
+    BinaryReader(const uint8_t *data, size_t size, BinaryType type)
+            : data_(data), size_(size), pos_(2) {
+        ok_ = size_ >= 2 && data_[0] == BINARY_FORMAT_VERSION && data_[1] == (uint8_t)type;
+    }
+
+    bool ok() const {
+        return ok_;
+    }
+
+    bool GetVarint(uint64_t &v) {
+        v = 0;
+        for(int shift = 0; ok_ && shift < 64; shift += 7){
+            if(pos_ >= size_) break;
+            uint8_t b = data_[pos_++];
+            v |= (uint64_t)(b & 0x7F) << shift;
+            if((b & 0x80) == 0) return true;
+        }
+        ok_ = false;
+        return false;
+    }
+
+    /**
+     * Read a varint in [0, INT_MAX].
+     */
+    bool GetInt(int &v) {
+        uint64_t u = 0;
+        if(!GetVarint(u) || u > (uint64_t)INT_MAX){
+            ok_ = false;
+            return false;
+        }
+        v = (int)u;
+        return true;
+    }
+
+    bool GetBN(safeheron::bignum::BN &num) {
+        uint64_t len = 0;
+        if(!GetVarint(len) || len > size_ - pos_){
+            ok_ = false;
+            return false;
+        }
+        num = len == 0 ? safeheron::bignum::BN::ZERO : safeheron::bignum::BN::FromBytesBE(data_ + pos_, (size_t)len);
+        pos_ += (size_t)len;
+        return true;
+    }
+
+    /**
+     * Skip a BN, and get where its big-endian bytes are, without decoding it.
+     */
+    bool SkipBN(size_t &offset, size_t &len) {
+        uint64_t t_len = 0;
+        if(!GetVarint(t_len) || t_len > size_ - pos_){
+            ok_ = false;
+            return false;
+        }
+        offset = pos_;
+        len = (size_t)t_len;
+        pos_ += len;
+        return true;
+    }
+
+    /**
+     * @return true if every byte was read without error.
+     */
+    bool Done() const {
+        return ok_ && pos_ == size_;
+    }
+
+private:
+    const uint8_t *data_;
+    size_t size_;
+    size_t pos_;
+    bool ok_;
+};
+
+};
+};
+
+#endif //SAFEHERON_TSS_RSA_BINARY_CODEC_H
@@ -0,0 +1,87 @@
+#include "emsa_pkcs1_v1_5.h"
+#include <cstring>
+#include "exception/located_exception.h"
+
+using std::string;
+using safeheron::exception::LocatedException;
+namespace safeheron {
+    namespace tss_rsa {
+
+        // DER encoding of the AlgorithmIdentifier of DigestInfo, up to the OCTET STRING header of the digest.
+        // See RFC 8017, Section 9.2, Note 1.
+        static const uint8_t SHA256_PREFIX[] = {0x30, 0x31, 0x30, 0x0d, 0x06, 0x09, 0x60, 0x86, 0x48, 0x01, 0x65, 0x03, 0x04, 0x02, 0x01, 0x05, 0x00, 0x04, 0x20};
+        static const uint8_t SHA384_PREFIX[] = {0x30, 0x41, 0x30, 0x0d, 0x06, 0x09, 0x60, 0x86, 0x48, 0x01, 0x65, 0x03, 0x04, 0x02, 0x02, 0x05, 0x00, 0x04, 0x30};
+        static const uint8_t SHA512_PREFIX[] = {0x30, 0x51, 0x30, 0x0d, 0x06, 0x09, 0x60, 0x86, 0x48, 0x01, 0x65, 0x03, 0x04, 0x02, 0x03, 0x05, 0x00, 0x04, 0x40};
+        static const uint8_t SHA3_256_PREFIX[] = {0x30, 0x31, 0x30, 0x0d, 0x06, 0x09, 0x60, 0x86, 0x48, 0x01, 0x65, 0x03, 0x04, 0x02, 0x08, 0x05, 0x00, 0x04, 0x20};
+        static const uint8_t SHA3_384_PREFIX[] = {0x30, 0x41, 0x30, 0x0d, 0x06, 0x09, 0x60, 0x86, 0x48, 0x01, 0x65, 0x03, 0x04, 0x02, 0x09, 0x05, 0x00, 0x04, 0x30};
+        static const uint8_t SHA3_512_PREFIX[] = {0x30, 0x51, 0x30, 0x0d, 0x06, 0x09, 0x60, 0x86, 0x48, 0x01, 0x65, 0x03, 0x04, 0x02, 0x0a, 0x05, 0x00, 0x04, 0x40};
+
+        static string DigestInfoPrefix(HashAlgorithm hash) {
+            switch (hash) {
+                case HashAlgorithm::SHA256:
+                    return string(reinterpret_cast<const char *>(SHA256_PREFIX), sizeof(SHA256_PREFIX));
+                case HashAlgorithm::SHA384:
+                    return string(reinterpret_cast<const char *>(SHA384_PREFIX), sizeof(SHA384_PREFIX));
+                case HashAlgorithm::SHA512:
+                    return string(reinterpret_cast<const char *>(SHA512_PREFIX), sizeof(SHA512_PREFIX));
+                case HashAlgorithm::SHA3_256:
+                    return string(reinterpret_cast<const char *>(SHA3_256_PREFIX), sizeof(SHA3_256_PREFIX));
+                case HashAlgorithm::SHA3_384:
+                    return string(reinterpret_cast<const char *>(SHA3_384_PREFIX), sizeof(SHA3_384_PREFIX));
+                case HashAlgorithm::SHA3_512:
+                    return string(reinterpret_cast<const char *>(SHA3_512_PREFIX), sizeof(SHA3_512_PREFIX));
+            }
+            throw LocatedException(__FILE__, __LINE__, __FUNCTION__, -1, "Unsupported hash algorithm.");
+        }
+
+        std::string EncodeEMSA_PKCS1_v1_5FromDigest(const std::string &mHash, int keyBits, HashAlgorithm hash) {
+            if(mHash.length() != HashOutputSize(hash)) {
+                throw LocatedException(__FILE__, __LINE__, __FUNCTION__, -1, "mHash.length() != HashOutputSize(hash)");
+            }
+            size_t emLen = (keyBits + 7) / 8;
+
+            // 2.  Encode the algorithm ID for the hash function and the hash value into an ASN.1 value of
+            //     type DigestInfo, T is an octet string of length tLen.
+            string T = DigestInfoPrefix(hash);
+            T.append(mHash);
+
+            // 3.  If emLen < tLen + 11, output "intended encoded message length too short" and stop.
+            if(emLen < T.length() + 11) {
+                throw LocatedException(__FILE__, __LINE__, __FUNCTION__, -1, "emLen error: KeyBitLength is too short.");
+            }
+
+            // 4.  Generate an octet string PS consisting of emLen - tLen - 3 octets with hexadecimal value 0xff.
+            // 5.  Let EM = 0x00 || 0x01 || PS || 0x00 || T.
+            string em;
+            em.reserve(emLen);
+            em.append(1, (char)0x00);
+            em.append(1, (char)0x01);
+            em.append(emLen - T.length() - 3, (char)0xff);
+            em.append(1, (char)0x00);
+            em.append(T);
+            return em;
+        }
+
+        std::string EncodeEMSA_PKCS1_v1_5(const std::string &m, int keyBits, HashAlgorithm hash) {
+            // 1.  Apply the hash function to the message M to produce a hash value H = Hash(M).
+            return EncodeEMSA_PKCS1_v1_5FromDigest(Digest(m, hash), keyBits, hash);
+        }
+
+        bool VerifyEMSA_PKCS1_v1_5FromDigest(const std::string &mHash, int keyBits, HashAlgorithm hash, const std::string &em) {
+            if(mHash.length() != HashOutputSize(hash)) {
+                return false;
+            }
+            size_t emLen = (keyBits + 7) / 8;
+            if(em.length() != emLen || emLen < DigestInfoPrefix(hash).length() + mHash.length() + 11) {
+                return false;
+            }
+            string expected = EncodeEMSA_PKCS1_v1_5FromDigest(mHash, keyBits, hash);
+            return memcmp(expected.c_str(), em.c_str(), emLen) == 0;
+        }
+
+        bool VerifyEMSA_PKCS1_v1_5(const std::string &m, int keyBits, HashAlgorithm hash, const std::string &em) {
+            return VerifyEMSA_PKCS1_v1_5FromDigest(Digest(m, hash), keyBits, hash, em);
+        }
+
+    }
+}
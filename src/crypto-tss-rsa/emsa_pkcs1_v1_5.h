@@ -0,0 +1,60 @@
+/*
+ * The EMSA_PKCS1_v1_5 encoding method references the EMSA-PKCS1-v1_5 encoding scheme according to RFC 8017
+ * See RFC 8017, Section 9.2 : https://datatracker.ietf.org/doc/html/rfc8017#section-9.2
+ * The encoding is deterministic: every party derives the same encoded message from the digest,
+ * without agreeing on a salt beforehand.
+ */
+
+#ifndef SAFEHERON_TSS_RSA_EMSA_PKCS1_V1_5_H
+#define SAFEHERON_TSS_RSA_EMSA_PKCS1_V1_5_H
+
+#include <string>
+#include "emsa_pss.h"
+
+namespace safeheron {
+    namespace tss_rsa {
+
+        /**
+         * EMSA-PKCS1-v1_5-ENCODE
+         * Refer to https://datatracker.ietf.org/doc/html/rfc8017#section-9.2
+         * @param m
+         * @param keyBits
+         * @param hash
+         * @return Encoding result, EM = 0x00 || 0x01 || PS || 0x00 || DigestInfo, ceil(keyBits / 8) bytes.
+         */
+        std::string EncodeEMSA_PKCS1_v1_5(const std::string &m, int keyBits, HashAlgorithm hash);
+
+        /**
+         * EMSA-PKCS1-v1_5-ENCODE of a message hashed beforehand.
+         * @param mHash digest of the message, HashOutputSize(hash) bytes.
+         * @param keyBits
+         * @param hash
+         * @return Encoding result, the same as the one of EncodeEMSA_PKCS1_v1_5 on the message.
+         */
+        std::string EncodeEMSA_PKCS1_v1_5FromDigest(const std::string &mHash, int keyBits, HashAlgorithm hash);
+
+        /**
+         * Check an EMSA-PKCS1-v1_5 encoding, by encoding the message again and comparing.
+         * Refer to https://datatracker.ietf.org/doc/html/rfc8017#section-8.2.2
+         * @param m
+         * @param keyBits
+         * @param hash
+         * @param em
+         * @return
+         */
+        bool VerifyEMSA_PKCS1_v1_5(const std::string &m, int keyBits, HashAlgorithm hash, const std::string &em);
+
+        /**
+         * Check an EMSA-PKCS1-v1_5 encoding of a message hashed beforehand.
+         * @param mHash digest of the message, HashOutputSize(hash) bytes.
+         * @param keyBits
+         * @param hash
+         * @param em
+         * @return false if the encoding is inconsistent or mHash has a wrong length.
+         */
+        bool VerifyEMSA_PKCS1_v1_5FromDigest(const std::string &mHash, int keyBits, HashAlgorithm hash, const std::string &em);
+
+    }
+}
+
+#endif //SAFEHERON_TSS_RSA_EMSA_PKCS1_V1_5_H
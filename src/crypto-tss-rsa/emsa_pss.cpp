@@ -1,6 +1,10 @@
 #include "emsa_pss.h"
 #include <cstring>
+#ifndef SAFEHERON_TSS_RSA_SGX
+#include <fstream>
+#endif
 #include <memory>
+#include <openssl/evp.h>
 #include "crypto-bn/bn.h"
 #include "crypto-bn/rand.h"
 #include "exception/located_exception.h"
@@ -12,119 +16,243 @@ using safeheron::exception::LocatedException;
 namespace safeheron {
     namespace tss_rsa {
 
-        std::string MGF1(const uint8_t *seed, size_t seedLen, size_t maskLen) {
-            string mask;
-            // Allocate CSHA256::OUTPUT_SIZE-1 more bytes.
-            mask.reserve(maskLen + CSHA256::OUTPUT_SIZE - 1);
-            for(size_t i = 0; i < (maskLen + CSHA256::OUTPUT_SIZE -1) / CSHA256::OUTPUT_SIZE; i++) {
-                uint8_t cnt[4];
-                cnt[0] = (unsigned char)((i >> 24) & 255);
-                cnt[1] = (unsigned char)((i >> 16) & 255);
-                cnt[2] = (unsigned char)((i >> 8)) & 255;
-                cnt[3] = (unsigned char)(i & 255);
+#ifndef SAFEHERON_TSS_RSA_SGX
+        // Size of the chunks read from a file, the memory used doesn't depend on the file size.
+        static const size_t FILE_CHUNK_SIZE = 1 << 20;
+#endif
+
+        // Largest output length of the hash functions, in bytes.
+        static const size_t MAX_HASH_OUTPUT_SIZE = 64;
+
+        template <HashAlgorithm A> struct EvpHashTraits;
+        template <> struct EvpHashTraits<HashAlgorithm::SHA384> {
+            static const size_t OUTPUT_SIZE = 48;
+            static const EVP_MD *md() { return EVP_sha384(); }
+        };
+        template <> struct EvpHashTraits<HashAlgorithm::SHA512> {
+            static const size_t OUTPUT_SIZE = 64;
+            static const EVP_MD *md() { return EVP_sha512(); }
+        };
+        template <> struct EvpHashTraits<HashAlgorithm::SHA3_256> {
+            static const size_t OUTPUT_SIZE = 32;
+            static const EVP_MD *md() { return EVP_sha3_256(); }
+        };
+        template <> struct EvpHashTraits<HashAlgorithm::SHA3_384> {
+            static const size_t OUTPUT_SIZE = 48;
+            static const EVP_MD *md() { return EVP_sha3_384(); }
+        };
+        template <> struct EvpHashTraits<HashAlgorithm::SHA3_512> {
+            static const size_t OUTPUT_SIZE = 64;
+            static const EVP_MD *md() { return EVP_sha3_512(); }
+        };
+
+        struct MdCtxDeleter {
+            void operator()(EVP_MD_CTX *ctx) const { EVP_MD_CTX_free(ctx); }
+        };
+
+        /**
+         * Hash function of OpenSSL with the interface of CSHA256.
+         */
+        template <HashAlgorithm A>
+        class EvpHash {
+        public:
+            static const size_t OUTPUT_SIZE = EvpHashTraits<A>::OUTPUT_SIZE;
+
+            EvpHash() : ctx_(EVP_MD_CTX_new()) {
+                if(!ctx_) throw LocatedException(__FILE__, __LINE__, __FUNCTION__, -1, "EVP_MD_CTX_new failed.");
+                Reset();
+            }
+
+            EvpHash &Write(const uint8_t *data, size_t len) {
+                if(EVP_DigestUpdate(ctx_.get(), data, len) != 1) {
+                    throw LocatedException(__FILE__, __LINE__, __FUNCTION__, -1, "EVP_DigestUpdate failed.");
+                }
+                return *this;
+            }
+
+            void Finalize(uint8_t *digest) {
+                if(EVP_DigestFinal_ex(ctx_.get(), digest, nullptr) != 1) {
+                    throw LocatedException(__FILE__, __LINE__, __FUNCTION__, -1, "EVP_DigestFinal_ex failed.");
+                }
+            }
 
-                uint8_t digest[CSHA256::OUTPUT_SIZE];
-                CSHA256 sha256;
-                sha256.Write(seed, seedLen);
-                sha256.Write(cnt, 4);
-                sha256.Finalize(digest);
+            EvpHash &Reset() {
+                if(EVP_DigestInit_ex(ctx_.get(), EvpHashTraits<A>::md(), nullptr) != 1) {
+                    throw LocatedException(__FILE__, __LINE__, __FUNCTION__, -1, "EVP_DigestInit_ex failed.");
+                }
+                return *this;
+            }
+
+        private:
+            std::unique_ptr<EVP_MD_CTX, MdCtxDeleter> ctx_;
+        };
+
+        template <HashAlgorithm A>
+        const size_t EvpHash<A>::OUTPUT_SIZE;
+
+        /**
+         * digest = Hash(seed || C), C the 4-octet counter i.
+         */
+        template <class Hash>
+        static void MGF1Block(const uint8_t *seed, size_t seedLen, size_t i, uint8_t *digest) {
+            uint8_t cnt[4];
+            cnt[0] = (unsigned char)((i >> 24) & 255);
+            cnt[1] = (unsigned char)((i >> 16) & 255);
+            cnt[2] = (unsigned char)((i >> 8)) & 255;
+            cnt[3] = (unsigned char)(i & 255);
+
+            Hash hash;
+            hash.Write(seed, seedLen);
+            hash.Write(cnt, 4);
+            hash.Finalize(digest);
+        }
 
-                mask.append(reinterpret_cast<const char *>(digest), CSHA256::OUTPUT_SIZE);
+        /**
+         * out = out \xor MGF1(seed, outLen), 8 bytes at a time.
+         */
+        template <class Hash>
+        static void MGF1Xor(const uint8_t *seed, size_t seedLen, uint8_t *out, size_t outLen) {
+            for(size_t i = 0, pos = 0; pos < outLen; i++, pos += Hash::OUTPUT_SIZE) {
+                uint8_t digest[Hash::OUTPUT_SIZE];
+                MGF1Block<Hash>(seed, seedLen, i, digest);
+
+                size_t len = outLen - pos < Hash::OUTPUT_SIZE ? outLen - pos : Hash::OUTPUT_SIZE;
+                size_t j = 0;
+                for(; j + 8 <= len; j += 8) {
+                    uint64_t w, d;
+                    memcpy(&w, out + pos + j, 8);
+                    memcpy(&d, digest + j, 8);
+                    w ^= d;
+                    memcpy(out + pos + j, &w, 8);
+                }
+                for(; j < len; j++) {
+                    out[pos + j] ^= digest[j];
+                }
             }
-            return mask.substr(0, maskLen);
         }
 
-        std::string EncodeEMSA_PSS(const std::string &m, int keyBits, SaltLength saltLength) {
+        /**
+         * MGF1 with the hash function Hash, into mask.
+         */
+        template <class Hash>
+        static void MGF1Impl(const uint8_t *seed, size_t seedLen, uint8_t *mask, size_t maskLen) {
+            for(size_t i = 0, pos = 0; pos < maskLen; i++, pos += Hash::OUTPUT_SIZE) {
+                if(maskLen - pos >= Hash::OUTPUT_SIZE) {
+                    MGF1Block<Hash>(seed, seedLen, i, mask + pos);
+                } else {
+                    // The last block is cut.
+                    uint8_t digest[Hash::OUTPUT_SIZE];
+                    MGF1Block<Hash>(seed, seedLen, i, digest);
+                    memcpy(mask + pos, digest, maskLen - pos);
+                }
+            }
+        }
+
+        void MGF1(const uint8_t *seed, size_t seedLen, uint8_t *mask, size_t maskLen) {
+            MGF1Impl<CSHA256>(seed, seedLen, mask, maskLen);
+        }
+
+        std::string MGF1(const uint8_t *seed, size_t seedLen, size_t maskLen) {
+            string mask(maskLen, '\0');
+            if(maskLen > 0) MGF1(seed, seedLen, reinterpret_cast<uint8_t *>(&mask[0]), maskLen);
+            return mask;
+        }
+
+        size_t EMSA_PSSLength(int keyBits) {
             size_t emBits = keyBits - 1;
+            return (emBits + 7) / 8;
+        }
 
-            size_t emLen = (emBits + 7) / 8;
+        /**
+         * EMSA-PSS-Encode with the hash function Hash, from step 3, with mHash = Hash(M) already computed.
+         */
+        template <class Hash>
+        static void EncodeEMSA_PSSImpl(const uint8_t *mHash, int keyBits, SaltLength saltLength, uint8_t *em, size_t emLen) {
+            size_t emBits = keyBits - 1;
+
+            if(emLen != (emBits + 7) / 8) {
+                throw LocatedException(__FILE__, __LINE__, __FUNCTION__, -1, "emLen != EMSA_PSSLength(keyBits)");
+            }
 
             // check emLen
-            if(emLen < CSHA256::OUTPUT_SIZE + 2) {
-                throw LocatedException(__FILE__, __LINE__, __FUNCTION__, -1, "emLen < CSHA256::OUTPUT_SIZE + 2");
+            if(emLen < Hash::OUTPUT_SIZE + 2) {
+                throw LocatedException(__FILE__, __LINE__, __FUNCTION__, -1, "emLen < hLen + 2");
             }
 
             size_t sLen;
             switch (saltLength) {
                 case SaltLength::AutoLength:
                 {
-                    sLen =  emLen - 2 - CSHA256::OUTPUT_SIZE;
+                    sLen =  emLen - 2 - Hash::OUTPUT_SIZE;
+                    break;
+                }
+                case SaltLength::ZeroLength:
+                {
+                    sLen = 0;
                     break;
                 }
                 case SaltLength::EqualToHash:
                 default:
                 {
-                    sLen = CSHA256::OUTPUT_SIZE;
+                    sLen = Hash::OUTPUT_SIZE;
                     break;
                 }
             }
 
-            // 2.  Let mHash = Hash(M), an octet string of length hLen.
-            uint8_t mHash[CSHA256::OUTPUT_SIZE];
-            CSHA256 sha256;
-            sha256.Write(reinterpret_cast<const uint8_t *>(m.c_str()), m.length());
-            sha256.Finalize(mHash);
-
             // 3.  If emLen < hLen + sLen + 2, output "encoding error" and stop.
-            if(emLen < CSHA256::OUTPUT_SIZE + sLen + 2) {
+            if(emLen < Hash::OUTPUT_SIZE + sLen + 2) {
                 throw LocatedException(__FILE__, __LINE__, __FUNCTION__, -1, "emLen error: KeyBitLength is too short.");
             }
 
+            // EM = maskedDB || H || 0xbc is built in place: DB is written to em, then masked.
+            size_t DBLen = emLen - Hash::OUTPUT_SIZE - 1;
+            uint8_t *DB = em;
+            uint8_t *H = em + DBLen;
+            uint8_t *salt = DB + (DBLen - sLen);
+
             // 4.  Generate a random octet string salt of length sLen; if sLen = 0, then salt is the empty string.
-            std::unique_ptr<uint8_t[]> salt(new uint8_t[sLen]);
-            if(sLen > 0) safeheron::rand::RandomBytes(salt.get(), sLen);
+            if(sLen > 0) safeheron::rand::RandomBytes(salt, sLen);
 
             // 5.  Let M' = (0x)00 00 00 00 00 00 00 00 || mHash || salt;
             //     M' is an octet string of length 8 + hLen + sLen with eight initial zero octets.
             // 6.  Let H = Hash(M'), an octet string of length hLen.
             uint8_t padding1[8] = {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
 
-            uint8_t H[CSHA256::OUTPUT_SIZE];
-            sha256.Reset();
-            sha256.Write(padding1, 8);
-            sha256.Write(mHash, CSHA256::OUTPUT_SIZE);
-            sha256.Write(salt.get(), sLen);
-            sha256.Finalize(H);
+            Hash hash;
+            hash.Write(padding1, 8);
+            hash.Write(mHash, Hash::OUTPUT_SIZE);
+            hash.Write(salt, sLen);
+            hash.Finalize(H);
 
             // 7.  Generate an octet string PS consisting of emLen - sLen - hLen - 2
             //     zero octets.  The length of PS may be 0.
             //
             // 8.  Let DB = PS || 0x01 || salt; DB is an octet string of length
             //       emLen - hLen - 1.
-            string DB;
-            DB.reserve(emLen - CSHA256::OUTPUT_SIZE - 1);
-            size_t PSLen = emLen - CSHA256::OUTPUT_SIZE - sLen - 2;
-            DB.append(PSLen, 0x00);
-            DB.append(1, 0x01);
-            DB.append(reinterpret_cast<const char *>(salt.get()), sLen);
+            size_t PSLen = emLen - Hash::OUTPUT_SIZE - sLen - 2;
+            memset(DB, 0x00, PSLen);
+            DB[PSLen] = 0x01;
 
             // 9.  Let dbMask = MGF(H, emLen - hLen - 1).  mask generation function
-            string dbMask = MGF1(H, CSHA256::OUTPUT_SIZE, emLen - CSHA256::OUTPUT_SIZE - 1);
-
             // 10. Let maskedDB = DB \xor dbMask.
-            string maskedDB;
-            maskedDB.reserve(emLen - CSHA256::OUTPUT_SIZE - 1);
-            for(size_t i = 0; i < emLen - CSHA256::OUTPUT_SIZE - 1; i++) {
-                maskedDB.append(1, DB[i] ^ dbMask[i]);
-            }
+            MGF1Xor<Hash>(H, Hash::OUTPUT_SIZE, DB, DBLen);
 
             // 11. Set the leftmost 8emLen - emBits bits of the leftmost octet in maskedDB to zero.
             uint8_t c = 255;
             for(size_t i = 0; i < emLen * 8 -emBits; i++) {
                 c = c >> 1;
             }
-            maskedDB[0] &= (char)c;
+            DB[0] &= c;
 
             // 12. Let EM = maskedDB || H || 0xbc.
-            string em;
-            em.reserve(emLen);
-            em.append(maskedDB);
-            em.append(reinterpret_cast<const char *>(H), CSHA256::OUTPUT_SIZE);
-            em.append(1, (char)0xbc);
-            return em;
+            em[emLen - 1] = 0xbc;
         }
 
-        bool VerifyEMSA_PSS(const std::string &m, int keyBits, SaltLength saltLength, const std::string &em) {
+        /**
+         * EMSA-PSS-VERIFY with the hash function Hash, with mHash = Hash(M) already computed.
+         */
+        template <class Hash>
+        static bool VerifyEMSA_PSSImpl(const uint8_t *mHash, int keyBits, SaltLength saltLength, const std::string &em) {
             size_t emBits = keyBits - 1;
             size_t emLen = (emBits + 7) / 8;
             if(em.length() != emLen) {
@@ -133,7 +261,7 @@ namespace safeheron {
             }
 
             // check emLen
-            if(emLen < CSHA256::OUTPUT_SIZE + 2) {
+            if(emLen < Hash::OUTPUT_SIZE + 2) {
                 return false;
             }
 
@@ -141,19 +269,24 @@ namespace safeheron {
             switch (saltLength) {
                 case SaltLength::AutoLength:
                 {
-                    sLen =  emLen - 2 - CSHA256::OUTPUT_SIZE;
+                    sLen =  emLen - 2 - Hash::OUTPUT_SIZE;
+                    break;
+                }
+                case SaltLength::ZeroLength:
+                {
+                    sLen = 0;
                     break;
                 }
                 case SaltLength::EqualToHash:
                 default:
                 {
-                    sLen = CSHA256::OUTPUT_SIZE;
+                    sLen = Hash::OUTPUT_SIZE;
                     break;
                 }
             }
 
             // 3.  If emLen < hLen + sLen + 2, output "inconsistent" and stop.
-            if(emLen < CSHA256::OUTPUT_SIZE + sLen + 2) {
+            if(emLen < Hash::OUTPUT_SIZE + sLen + 2) {
                 // error: KeyBitLength is too short.
                 return false;
             }
@@ -166,7 +299,7 @@ namespace safeheron {
 
             // 5.  Let maskedDB be the leftmost emLen - hLen - 1 octets of EM, and let H be the next hLen octets.
             const uint8_t *maskedDB = reinterpret_cast<const uint8_t *>(em.c_str());
-            const uint8_t *H = maskedDB + (emLen - CSHA256::OUTPUT_SIZE - 1);
+            const uint8_t *H = maskedDB + (emLen - Hash::OUTPUT_SIZE - 1);
 
             // 6.  If the leftmost 8emLen - emBits bits of the leftmost octet in maskedDB are not all equal to zero, output "inconsistent" and stop.
             uint8_t c = 255;
@@ -180,15 +313,12 @@ namespace safeheron {
             }
 
             // 7.  Let dbMask = MGF(H, emLen - hLen - 1).
-            string mask = MGF1(H, CSHA256::OUTPUT_SIZE, emLen - CSHA256::OUTPUT_SIZE - 1);
-            const uint8_t *dbMask = (uint8_t *) mask.c_str();
-
             // 8.  Let DB = maskedDB \xor dbMask.
-            size_t DBLen = emLen - CSHA256::OUTPUT_SIZE - 1;
+            // dbMask is XORed into a copy of maskedDB block by block, without building it.
+            size_t DBLen = emLen - Hash::OUTPUT_SIZE - 1;
             std::unique_ptr<uint8_t[]> DB(new uint8_t[DBLen]);
-            for(size_t i = 0; i < DBLen; i++) {
-                DB[i] = maskedDB[i] ^ dbMask[i];
-            }
+            memcpy(DB.get(), maskedDB, DBLen);
+            MGF1Xor<Hash>(H, Hash::OUTPUT_SIZE, DB.get(), DBLen);
 
             // 9.  Set the leftmost 8emLen - emBits bits of the leftmost octet in DB to zero.
             c = 255;
@@ -201,7 +331,7 @@ namespace safeheron {
             //    or if the octet at position emLen - hLen - sLen - 1 (the leftmost
             //    position is "position 1") does not have hexadecimal value 0x01,
             //    output "inconsistent" and stop.
-            int PS_len = emLen - CSHA256::OUTPUT_SIZE - sLen - 2;
+            int PS_len = emLen - Hash::OUTPUT_SIZE - sLen - 2;
             const uint8_t * PS = DB.get();
             for(int i = 0; i < PS_len; i++) {
                 if(PS[i] != 0x00) {
@@ -210,7 +340,7 @@ namespace safeheron {
                 }
             }
 
-            uint8_t left_padding = DB[emLen - CSHA256::OUTPUT_SIZE - sLen - 2];
+            uint8_t left_padding = DB[emLen - Hash::OUTPUT_SIZE - sLen - 2];
             if(left_padding != (unsigned char)0x01) {
                 // error: inconsistent.
                 return false;
@@ -218,31 +348,284 @@ namespace safeheron {
 
             // 11.  Let salt be the last sLen octets of DB.
             uint8_t padding1[8] = {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
-            const uint8_t *solt = DB.get() + (emLen - CSHA256::OUTPUT_SIZE - 1 - sLen);
-
-            uint8_t mHash[CSHA256::OUTPUT_SIZE];
-            CSHA256 sha256;
-            sha256.Write(reinterpret_cast<const uint8_t *>(m.c_str()), m.length());
-            sha256.Finalize(mHash);
+            const uint8_t *solt = DB.get() + (emLen - Hash::OUTPUT_SIZE - 1 - sLen);
 
             // 12.  Let
             //          M' = (0x)00 00 00 00 00 00 00 00 || mHash || salt ;
             //      M' is an octet string of length 8 + hLen + sLen with eight initial zero octets.
             // 13. Let H' = Hash(M'), an octet string of length hLen.
-            uint8_t HPrime[CSHA256::OUTPUT_SIZE];
-            sha256.Reset();
-            sha256.Write(padding1, 8);
-            sha256.Write(mHash, CSHA256::OUTPUT_SIZE);
-            sha256.Write(solt, sLen);
-            sha256.Finalize(HPrime);
+            uint8_t HPrime[Hash::OUTPUT_SIZE];
+            Hash hash;
+            hash.Write(padding1, 8);
+            hash.Write(mHash, Hash::OUTPUT_SIZE);
+            hash.Write(solt, sLen);
+            hash.Finalize(HPrime);
 
             // 14. If H = H', output "consistent." Otherwise, output "inconsistent."
-            if(strncmp((char*)H, (char*)HPrime, CSHA256::OUTPUT_SIZE) == 0) {
+            if(memcmp(H, HPrime, Hash::OUTPUT_SIZE) == 0) {
                 return true;
             } else {
                 return false;
             }
         }
 
+        /**
+         * Runs op.Run<Hash>() with the class Hash of the hash function.
+         */
+        template <class Op>
+        static void DispatchHash(HashAlgorithm hash, Op &op) {
+            switch (hash) {
+                case HashAlgorithm::SHA256:
+                    op.template Run<CSHA256>();
+                    return;
+                case HashAlgorithm::SHA384:
+                    op.template Run<EvpHash<HashAlgorithm::SHA384> >();
+                    return;
+                case HashAlgorithm::SHA512:
+                    op.template Run<EvpHash<HashAlgorithm::SHA512> >();
+                    return;
+                case HashAlgorithm::SHA3_256:
+                    op.template Run<EvpHash<HashAlgorithm::SHA3_256> >();
+                    return;
+                case HashAlgorithm::SHA3_384:
+                    op.template Run<EvpHash<HashAlgorithm::SHA3_384> >();
+                    return;
+                case HashAlgorithm::SHA3_512:
+                    op.template Run<EvpHash<HashAlgorithm::SHA3_512> >();
+                    return;
+            }
+            throw LocatedException(__FILE__, __LINE__, __FUNCTION__, -1, "Unsupported hash algorithm.");
+        }
+
+        struct OutputSizeOp {
+            size_t size;
+            template <class Hash> void Run() { size = Hash::OUTPUT_SIZE; }
+        };
+
+        struct MGF1Op {
+            const uint8_t *seed; size_t seedLen; uint8_t *mask; size_t maskLen;
+            template <class Hash> void Run() { MGF1Impl<Hash>(seed, seedLen, mask, maskLen); }
+        };
+
+        struct DigestOp {
+            const uint8_t *m; size_t mLen; uint8_t *mHash;
+            template <class Hash> void Run() { Hash hash; hash.Write(m, mLen); hash.Finalize(mHash); }
+        };
+
+        struct EncodeOp {
+            const uint8_t *mHash; int keyBits; SaltLength saltLength; uint8_t *em; size_t emLen;
+            template <class Hash> void Run() { EncodeEMSA_PSSImpl<Hash>(mHash, keyBits, saltLength, em, emLen); }
+        };
+
+        struct VerifyOp {
+            const uint8_t *mHash; int keyBits; SaltLength saltLength; const std::string *em; bool ok;
+            template <class Hash> void Run() { ok = VerifyEMSA_PSSImpl<Hash>(mHash, keyBits, saltLength, *em); }
+        };
+
+        size_t HashOutputSize(HashAlgorithm hash) {
+            OutputSizeOp op = {0};
+            DispatchHash(hash, op);
+            return op.size;
+        }
+
+        std::string Digest(const std::string &m, HashAlgorithm hash) {
+            uint8_t mHash[MAX_HASH_OUTPUT_SIZE];
+            DigestOp op = {reinterpret_cast<const uint8_t *>(m.c_str()), m.length(), mHash};
+            DispatchHash(hash, op);
+            return std::string(reinterpret_cast<const char *>(mHash), HashOutputSize(hash));
+        }
+
+        void MGF1(const uint8_t *seed, size_t seedLen, HashAlgorithm hash, uint8_t *mask, size_t maskLen) {
+            MGF1Op op = {seed, seedLen, mask, maskLen};
+            DispatchHash(hash, op);
+        }
+
+        void EncodeEMSA_PSSFromDigest(const uint8_t *mHash, int keyBits, SaltLength saltLength, HashAlgorithm hash, uint8_t *em, size_t emLen) {
+            EncodeOp op = {mHash, keyBits, saltLength, em, emLen};
+            DispatchHash(hash, op);
+        }
+
+        void EncodeEMSA_PSSFromDigest(const uint8_t *mHash, int keyBits, SaltLength saltLength, uint8_t *em, size_t emLen) {
+            EncodeEMSA_PSSImpl<CSHA256>(mHash, keyBits, saltLength, em, emLen);
+        }
+
+        void EncodeEMSA_PSS(const uint8_t *m, size_t mLen, int keyBits, SaltLength saltLength, HashAlgorithm hash, uint8_t *em, size_t emLen) {
+            // 2.  Let mHash = Hash(M), an octet string of length hLen.
+            uint8_t mHash[MAX_HASH_OUTPUT_SIZE];
+            DigestOp op = {m, mLen, mHash};
+            DispatchHash(hash, op);
+            EncodeEMSA_PSSFromDigest(mHash, keyBits, saltLength, hash, em, emLen);
+        }
+
+        void EncodeEMSA_PSS(const uint8_t *m, size_t mLen, int keyBits, SaltLength saltLength, uint8_t *em, size_t emLen) {
+            // 2.  Let mHash = Hash(M), an octet string of length hLen.
+            uint8_t mHash[CSHA256::OUTPUT_SIZE];
+            CSHA256 sha256;
+            sha256.Write(m, mLen);
+            sha256.Finalize(mHash);
+            EncodeEMSA_PSSImpl<CSHA256>(mHash, keyBits, saltLength, em, emLen);
+        }
+
+        /**
+         * EMSA-PSS-Encode into a new string, with mHash = Hash(M) already computed.
+         */
+        static std::string EncodeEMSA_PSSFromHash(const uint8_t *mHash, int keyBits, SaltLength saltLength, HashAlgorithm hash) {
+            size_t emLen = EMSA_PSSLength(keyBits);
+            string em(emLen, '\0');
+            EncodeEMSA_PSSFromDigest(mHash, keyBits, saltLength, hash, reinterpret_cast<uint8_t *>(&em[0]), emLen);
+            return em;
+        }
+
+        /**
+         * EMSA-PSS-VERIFY, with mHash = Hash(M) already computed.
+         */
+        static bool VerifyEMSA_PSSFromHash(const uint8_t *mHash, int keyBits, SaltLength saltLength, HashAlgorithm hash, const std::string &em) {
+            VerifyOp op = {mHash, keyBits, saltLength, &em, false};
+            DispatchHash(hash, op);
+            return op.ok;
+        }
+
+        std::string EncodeEMSA_PSS(const std::string &m, int keyBits, SaltLength saltLength, HashAlgorithm hash) {
+            // 2.  Let mHash = Hash(M), an octet string of length hLen.
+            uint8_t mHash[MAX_HASH_OUTPUT_SIZE];
+            DigestOp op = {reinterpret_cast<const uint8_t *>(m.c_str()), m.length(), mHash};
+            DispatchHash(hash, op);
+            return EncodeEMSA_PSSFromHash(mHash, keyBits, saltLength, hash);
+        }
+
+        std::string EncodeEMSA_PSS(const std::string &m, int keyBits, SaltLength saltLength) {
+            return EncodeEMSA_PSS(m, keyBits, saltLength, HashAlgorithm::SHA256);
+        }
+
+        bool VerifyEMSA_PSS(const std::string &m, int keyBits, SaltLength saltLength, HashAlgorithm hash, const std::string &em) {
+            // 2.  Let mHash = Hash(M), an octet string of length hLen.
+            uint8_t mHash[MAX_HASH_OUTPUT_SIZE];
+            DigestOp op = {reinterpret_cast<const uint8_t *>(m.c_str()), m.length(), mHash};
+            DispatchHash(hash, op);
+            return VerifyEMSA_PSSFromHash(mHash, keyBits, saltLength, hash, em);
+        }
+
+        bool VerifyEMSA_PSS(const std::string &m, int keyBits, SaltLength saltLength, const std::string &em) {
+            return VerifyEMSA_PSS(m, keyBits, saltLength, HashAlgorithm::SHA256, em);
+        }
+
+        std::string EncodeEMSA_PSSFromDigest(const std::string &mHash, int keyBits, SaltLength saltLength, HashAlgorithm hash) {
+            if(mHash.length() != HashOutputSize(hash)) {
+                throw LocatedException(__FILE__, __LINE__, __FUNCTION__, -1, "mHash.length() != HashOutputSize(hash)");
+            }
+            return EncodeEMSA_PSSFromHash(reinterpret_cast<const uint8_t *>(mHash.c_str()), keyBits, saltLength, hash);
+        }
+
+        std::string EncodeEMSA_PSSFromDigest(const std::string &mHash, int keyBits, SaltLength saltLength) {
+            return EncodeEMSA_PSSFromDigest(mHash, keyBits, saltLength, HashAlgorithm::SHA256);
+        }
+
+        bool VerifyEMSA_PSSFromDigest(const std::string &mHash, int keyBits, SaltLength saltLength, HashAlgorithm hash, const std::string &emsa_pss) {
+            if(mHash.length() != HashOutputSize(hash)) {
+                return false;
+            }
+            return VerifyEMSA_PSSFromHash(reinterpret_cast<const uint8_t *>(mHash.c_str()), keyBits, saltLength, hash, emsa_pss);
+        }
+
+        bool VerifyEMSA_PSSFromDigest(const std::string &mHash, int keyBits, SaltLength saltLength, const std::string &emsa_pss) {
+            return VerifyEMSA_PSSFromDigest(mHash, keyBits, saltLength, HashAlgorithm::SHA256, emsa_pss);
+        }
+
+        /**
+         * Incremental hash of the message of PssEncoder and PssVerifier.
+         */
+        class MessageHash {
+        public:
+            virtual ~MessageHash() {}
+            virtual void Write(const uint8_t *data, size_t len) = 0;
+            /**
+             * Output the digest and reset the hash.
+             */
+            virtual void Finalize(uint8_t *digest) = 0;
+        };
+
+        template <class Hash>
+        class MessageHashImpl : public MessageHash {
+        public:
+            void Write(const uint8_t *data, size_t len) override { hash_.Write(data, len); }
+            void Finalize(uint8_t *digest) override { hash_.Finalize(digest); hash_.Reset(); }
+        private:
+            Hash hash_;
+        };
+
+        struct NewMessageHashOp {
+            MessageHash *ptr;
+            template <class Hash> void Run() { ptr = new MessageHashImpl<Hash>(); }
+        };
+
+        static MessageHash *NewMessageHash(HashAlgorithm hash) {
+            NewMessageHashOp op = {nullptr};
+            DispatchHash(hash, op);
+            return op.ptr;
+        }
+
+#ifndef SAFEHERON_TSS_RSA_SGX
+        /**
+         * Feed the content of a file into the hash, in chunks of FILE_CHUNK_SIZE bytes.
+         */
+        static bool WriteFile(MessageHash &hash, const std::string &path) {
+            std::ifstream in(path, std::ios::binary);
+            if(!in) return false;
+            std::unique_ptr<char[]> buf(new char[FILE_CHUNK_SIZE]);
+            while(in) {
+                in.read(buf.get(), FILE_CHUNK_SIZE);
+                std::streamsize len = in.gcount();
+                if(len > 0) hash.Write(reinterpret_cast<const uint8_t *>(buf.get()), (size_t)len);
+            }
+            return in.eof();
+        }
+#endif
+
+        PssEncoder::PssEncoder(SaltLength saltLength) : PssEncoder(saltLength, HashAlgorithm::SHA256) {}
+
+        PssEncoder::PssEncoder(SaltLength saltLength, HashAlgorithm hash)
+                : saltLength_(saltLength), hashAlgorithm_(hash), hash_(NewMessageHash(hash)) {}
+
+        PssEncoder::~PssEncoder() {}
+
+        void PssEncoder::Update(const uint8_t *data, size_t len) {
+            hash_->Write(data, len);
+        }
+
+#ifndef SAFEHERON_TSS_RSA_SGX
+        bool PssEncoder::UpdateFromFile(const std::string &path) {
+            return WriteFile(*hash_, path);
+        }
+#endif
+
+        std::string PssEncoder::Finalize(int keyBits) {
+            uint8_t mHash[MAX_HASH_OUTPUT_SIZE];
+            hash_->Finalize(mHash);
+            return EncodeEMSA_PSSFromHash(mHash, keyBits, saltLength_, hashAlgorithm_);
+        }
+
+        PssVerifier::PssVerifier(SaltLength saltLength) : PssVerifier(saltLength, HashAlgorithm::SHA256) {}
+
+        PssVerifier::PssVerifier(SaltLength saltLength, HashAlgorithm hash)
+                : saltLength_(saltLength), hashAlgorithm_(hash), hash_(NewMessageHash(hash)) {}
+
+        PssVerifier::~PssVerifier() {}
+
+        void PssVerifier::Update(const uint8_t *data, size_t len) {
+            hash_->Write(data, len);
+        }
+
+#ifndef SAFEHERON_TSS_RSA_SGX
+        bool PssVerifier::UpdateFromFile(const std::string &path) {
+            return WriteFile(*hash_, path);
+        }
+#endif
+
+        bool PssVerifier::Finalize(int keyBits, const std::string &emsa_pss) {
+            uint8_t mHash[MAX_HASH_OUTPUT_SIZE];
+            hash_->Finalize(mHash);
+            return VerifyEMSA_PSSFromHash(mHash, keyBits, saltLength_, hashAlgorithm_, emsa_pss);
+        }
+
     }
 }
@@ -10,13 +10,44 @@
 
 #include "crypto-bn/bn.h"
 #include "crypto-bn/rand.h"
+#include <memory>
+#include <string>
 
 namespace safeheron {
     namespace tss_rsa {
         enum class SaltLength {
             AutoLength,
-            EqualToHash
+            EqualToHash,
+            ZeroLength  /**< no salt: the encoding is deterministic, every party derives the same one from the digest */
         };
+
+        /**
+         * Hash function of EMSA-PSS, used both for the message and in MGF1.
+         * SHA256 uses CSHA256 of crypto-suites, the others use OpenSSL.
+         */
+        enum class HashAlgorithm {
+            SHA256,
+            SHA384,
+            SHA512,
+            SHA3_256,
+            SHA3_384,
+            SHA3_512
+        };
+
+        /**
+         * Output length of a hash function.
+         * @param hash
+         * @return hLen, in bytes.
+         */
+        size_t HashOutputSize(HashAlgorithm hash);
+
+        /**
+         * Hash a message, mHash of the "FromDigest" functions.
+         * @param m
+         * @param hash
+         * @return digest of m, HashOutputSize(hash) bytes.
+         */
+        std::string Digest(const std::string &m, HashAlgorithm hash);
         /**
          * Mask generation function
          * Refer to https://datatracker.ietf.org/doc/html/rfc3447#appendix-B.2.1
@@ -27,6 +58,32 @@ namespace safeheron {
          */
         std::string MGF1(const uint8_t *seed, size_t seedLen, size_t maskLen);
 
+        /**
+         * Mask generation function, into a buffer of the caller.
+         * @param seed
+         * @param seedLen
+         * @param mask output buffer of maskLen bytes.
+         * @param maskLen
+         */
+        void MGF1(const uint8_t *seed, size_t seedLen, uint8_t *mask, size_t maskLen);
+
+        /**
+         * Mask generation function with the given hash function, into a buffer of the caller.
+         * @param seed
+         * @param seedLen
+         * @param hash
+         * @param mask output buffer of maskLen bytes.
+         * @param maskLen
+         */
+        void MGF1(const uint8_t *seed, size_t seedLen, HashAlgorithm hash, uint8_t *mask, size_t maskLen);
+
+        /**
+         * Length of the EMSA-PSS encoding under a key of keyBits bits.
+         * @param keyBits
+         * @return emLen = ceil((keyBits - 1) / 8)
+         */
+        size_t EMSA_PSSLength(int keyBits);
+
         /**
          * EMSA-PSS-Encode
          * Refer to https://datatracker.ietf.org/doc/html/rfc3447#section-9.1.1
@@ -37,6 +94,39 @@ namespace safeheron {
          */
         std::string EncodeEMSA_PSS(const std::string &m, int keyBits, SaltLength saltLength);
 
+        /**
+         * EMSA-PSS-Encode with the given hash function.
+         * @param m
+         * @param keyBits
+         * @param saltLength
+         * @param hash
+         * @return Encoding result.
+         */
+        std::string EncodeEMSA_PSS(const std::string &m, int keyBits, SaltLength saltLength, HashAlgorithm hash);
+
+        /**
+         * EMSA-PSS-Encode into a buffer of the caller, without heap allocation.
+         * @param m
+         * @param mLen
+         * @param keyBits
+         * @param saltLength
+         * @param em output buffer.
+         * @param emLen size of em, must be EMSA_PSSLength(keyBits).
+         */
+        void EncodeEMSA_PSS(const uint8_t *m, size_t mLen, int keyBits, SaltLength saltLength, uint8_t *em, size_t emLen);
+
+        /**
+         * EMSA-PSS-Encode with the given hash function into a buffer of the caller, without heap allocation.
+         * @param m
+         * @param mLen
+         * @param keyBits
+         * @param saltLength
+         * @param hash
+         * @param em output buffer.
+         * @param emLen size of em, must be EMSA_PSSLength(keyBits).
+         */
+        void EncodeEMSA_PSS(const uint8_t *m, size_t mLen, int keyBits, SaltLength saltLength, HashAlgorithm hash, uint8_t *em, size_t emLen);
+
         /**
          * EMSA-PSS-VERIFY
          * Refer to https://datatracker.ietf.org/doc/html/rfc3447#section-9.1.2
@@ -48,6 +138,173 @@ namespace safeheron {
          */
         bool VerifyEMSA_PSS(const std::string &m, int keyBits, SaltLength saltLength, const std::string &emsa_pss);
 
+        /**
+         * EMSA-PSS-VERIFY with the given hash function.
+         * @param m
+         * @param keyBits
+         * @param saltLength
+         * @param hash
+         * @param emsa_pss
+         * @return
+         */
+        bool VerifyEMSA_PSS(const std::string &m, int keyBits, SaltLength saltLength, HashAlgorithm hash, const std::string &emsa_pss);
+
+        /**
+         * EMSA-PSS-Encode of a message hashed beforehand.
+         * Refer to https://datatracker.ietf.org/doc/html/rfc3447#section-9.1.1, from step 3.
+         * @param mHash SHA256 digest of the message, 32 bytes.
+         * @param keyBits
+         * @param saltLength
+         * @return Encoding result, the same as the one of EncodeEMSA_PSS on the message.
+         */
+        std::string EncodeEMSA_PSSFromDigest(const std::string &mHash, int keyBits, SaltLength saltLength);
+
+        /**
+         * EMSA-PSS-Encode of a message hashed beforehand with the given hash function.
+         * @param mHash digest of the message, HashOutputSize(hash) bytes.
+         * @param keyBits
+         * @param saltLength
+         * @param hash
+         * @return Encoding result, the same as the one of EncodeEMSA_PSS on the message.
+         */
+        std::string EncodeEMSA_PSSFromDigest(const std::string &mHash, int keyBits, SaltLength saltLength, HashAlgorithm hash);
+
+        /**
+         * EMSA-PSS-Encode of a message hashed beforehand, into a buffer of the caller, without heap allocation.
+         * @param mHash SHA256 digest of the message, 32 bytes.
+         * @param keyBits
+         * @param saltLength
+         * @param em output buffer.
+         * @param emLen size of em, must be EMSA_PSSLength(keyBits).
+         */
+        void EncodeEMSA_PSSFromDigest(const uint8_t *mHash, int keyBits, SaltLength saltLength, uint8_t *em, size_t emLen);
+
+        /**
+         * EMSA-PSS-Encode of a message hashed beforehand with the given hash function, into a buffer of the caller.
+         * @param mHash digest of the message, HashOutputSize(hash) bytes.
+         * @param keyBits
+         * @param saltLength
+         * @param hash
+         * @param em output buffer.
+         * @param emLen size of em, must be EMSA_PSSLength(keyBits).
+         */
+        void EncodeEMSA_PSSFromDigest(const uint8_t *mHash, int keyBits, SaltLength saltLength, HashAlgorithm hash, uint8_t *em, size_t emLen);
+
+        /**
+         * EMSA-PSS-VERIFY of a message hashed beforehand.
+         * Refer to https://datatracker.ietf.org/doc/html/rfc3447#section-9.1.2, from step 3.
+         * @param mHash SHA256 digest of the message, 32 bytes.
+         * @param keyBits
+         * @param saltLength
+         * @param emsa_pss
+         * @return false if the encoding is inconsistent or mHash is not 32 bytes.
+         */
+        bool VerifyEMSA_PSSFromDigest(const std::string &mHash, int keyBits, SaltLength saltLength, const std::string &emsa_pss);
+
+        /**
+         * EMSA-PSS-VERIFY of a message hashed beforehand with the given hash function.
+         * @param mHash digest of the message, HashOutputSize(hash) bytes.
+         * @param keyBits
+         * @param saltLength
+         * @param hash
+         * @param emsa_pss
+         * @return false if the encoding is inconsistent or mHash has a wrong length.
+         */
+        bool VerifyEMSA_PSSFromDigest(const std::string &mHash, int keyBits, SaltLength saltLength, HashAlgorithm hash, const std::string &emsa_pss);
+
+        class MessageHash;
+
+        /**
+         * Incremental EMSA-PSS-Encode, for messages which don't fit in memory.
+         * The message is fed by "Update" in pieces of any size, the result is the same as the one of
+         * EncodeEMSA_PSS on the whole message.
+         */
+        class PssEncoder {
+        public:
+            explicit PssEncoder(SaltLength saltLength);
+
+            PssEncoder(SaltLength saltLength, HashAlgorithm hash);
+
+            ~PssEncoder();
+
+            /**
+             * Feed the next bytes of the message.
+             * @param data
+             * @param len
+             */
+            void Update(const uint8_t *data, size_t len);
+
+#ifndef SAFEHERON_TSS_RSA_SGX
+            /**
+             * Feed the content of a file, read in chunks of 1 MiB. Not part of the SGX build.
+             * @param path
+             * @return false if the file can't be read.
+             */
+            bool UpdateFromFile(const std::string &path);
+#endif
+
+            /**
+             * Encode the message fed so far, and reset the encoder for a new message.
+             * @param keyBits
+             * @return Encoding result.
+             */
+            std::string Finalize(int keyBits);
+
+        private:
+            PssEncoder(const PssEncoder &);
+            PssEncoder &operator=(const PssEncoder &);
+
+            SaltLength saltLength_;
+            HashAlgorithm hashAlgorithm_;
+            std::unique_ptr<MessageHash> hash_;
+        };
+
+        /**
+         * Incremental EMSA-PSS-VERIFY, for messages which don't fit in memory.
+         * The message is fed by "Update" in pieces of any size, the result is the same as the one of
+         * VerifyEMSA_PSS on the whole message.
+         */
+        class PssVerifier {
+        public:
+            explicit PssVerifier(SaltLength saltLength);
+
+            PssVerifier(SaltLength saltLength, HashAlgorithm hash);
+
+            ~PssVerifier();
+
+            /**
+             * Feed the next bytes of the message.
+             * @param data
+             * @param len
+             */
+            void Update(const uint8_t *data, size_t len);
+
+#ifndef SAFEHERON_TSS_RSA_SGX
+            /**
+             * Feed the content of a file, read in chunks of 1 MiB. Not part of the SGX build.
+             * @param path
+             * @return false if the file can't be read.
+             */
+            bool UpdateFromFile(const std::string &path);
+#endif
+
+            /**
+             * Verify the encoding of the message fed so far, and reset the verifier for a new message.
+             * @param keyBits
+             * @param emsa_pss
+             * @return
+             */
+            bool Finalize(int keyBits, const std::string &emsa_pss);
+
+        private:
+            PssVerifier(const PssVerifier &);
+            PssVerifier &operator=(const PssVerifier &);
+
+            SaltLength saltLength_;
+            HashAlgorithm hashAlgorithm_;
+            std::unique_ptr<MessageHash> hash_;
+        };
+
     }
 }
 
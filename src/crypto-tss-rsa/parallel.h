@@ -0,0 +1,75 @@
+#ifndef SAFEHERON_TSS_RSA_PARALLEL_H
+#define SAFEHERON_TSS_RSA_PARALLEL_H
+
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <vector>
+#ifndef SAFEHERON_TSS_RSA_SGX
+#include <thread>
+#endif
+
+namespace safeheron {
+namespace tss_rsa{
+
+/**
+ * Call func(j) for j = 0, ..., count - 1 on thread_num threads, the calling thread included.
+ *
+ * The items are handed out one by one, so uneven items are balanced between the threads. If an
+ * item throws, the remaining items are skipped and the first exception is rethrown in the
+ * calling thread.
+ *
+ * In the SGX build, where an enclave can't spawn threads, all the items run in the calling thread.
+ * @param[in] count number of items.
+ * @param[in] thread_num number of threads, 1 to run all the items in the calling thread.
+ * @param[in] func function of the item index.
+ */
+template<typename Func>
+void ParallelFor(size_t count, int thread_num, Func func) {
+#ifdef SAFEHERON_TSS_RSA_SGX
+    for(size_t j = 0; j < count; j++) func(j);
+#else
+    if(thread_num <= 1 || count <= 1){
+        for(size_t j = 0; j < count; j++) func(j);
+        return;
+    }
+    if((size_t)thread_num > count) thread_num = (int)count;
+
+    std::atomic<size_t> next(0);
+    std::atomic<bool> failed(false);
+    std::mutex mutex;
+    std::exception_ptr error;
+    auto worker = [&]() {
+        while(!failed.load()){
+            size_t j = next.fetch_add(1);
+            if(j >= count) return;
+            try {
+                func(j);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(mutex);
+                if(!error) error = std::current_exception();
+                failed.store(true);
+            }
+        }
+    };
+
+    std::vector<std::thread> thread_arr;
+    try {
+        for(int t = 1; t < thread_num; t++){
+            thread_arr.emplace_back(worker);
+        }
+    } catch (...) {
+        failed.store(true);
+        for(auto &t : thread_arr) t.join();
+        throw;
+    }
+    worker();
+    for(auto &t : thread_arr) t.join();
+    if(error) std::rethrow_exception(error);
+#endif
+}
+
+};
+};
+
+#endif //SAFEHERON_TSS_RSA_PARALLEL_H
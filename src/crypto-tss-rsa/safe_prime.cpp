@@ -0,0 +1,279 @@
+#include "safe_prime.h"
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <string>
+#include <vector>
+#ifndef SAFEHERON_TSS_RSA_SGX
+#include <thread>
+#endif
+#include "crypto-bn/rand.h"
+#include "exception/located_exception.h"
+
+using safeheron::bignum::BN;
+using safeheron::exception::LocatedException;
+
+namespace safeheron {
+namespace tss_rsa{
+
+namespace {
+
+/**
+ * Odd primes below bound, by the sieve of Eratosthenes.
+ */
+std::vector<uint32_t> SmallOddPrimes(uint32_t bound) {
+    std::vector<uint32_t> prime_arr;
+    std::vector<char> composite(bound, 0);
+    for(uint32_t r = 3; r < bound; r += 2){
+        if(composite[r]) continue;
+        prime_arr.push_back(r);
+        for(uint64_t t = (uint64_t)r * r; t < bound; t += 2 * r){
+            composite[t] = 1;
+        }
+    }
+    return prime_arr;
+}
+
+/**
+ * Residues of num modulo each small prime.
+ */
+void SmallResidues(const BN &num, const std::vector<uint32_t> &prime_arr, std::vector<uint32_t> &residue_arr) {
+    std::string buf;
+    num.ToBytesBE(buf);
+    residue_arr.resize(prime_arr.size());
+    for(size_t t = 0; t < prime_arr.size(); t++){
+        uint64_t r = prime_arr[t];
+        uint64_t residue = 0;
+        for(unsigned char c : buf){
+            residue = ((residue << 8) | c) % r;
+        }
+        residue_arr[t] = (uint32_t)residue;
+    }
+}
+
+/**
+ * Sieve windows of candidates until a safe prime is found, or until another worker sets "done".
+ * @return true if out is a safe prime, false if the search was cancelled.
+ */
+bool SieveSearchSafePrime(size_t bits,
+                          const SafePrimeSieveParam &param,
+                          const std::vector<uint32_t> &prime_arr,
+                          const std::atomic<bool> &done,
+                          BN &out,
+                          SafePrimeSearchStat &stat) {
+    // p' has (bits - 1) bits, so that p = 2p' + 1 has exactly "bits" bits.
+    const BN top = BN(1) << (bits - 2);
+    const BN limit = BN(1) << (bits - 1);
+    const uint64_t step = 2 * (uint64_t)param.interval;
+
+    BN start;
+    std::vector<uint32_t> residue_arr;
+    std::vector<char> sieve(param.interval);
+    bool restart = true;
+    while(!done.load()){
+        if(restart){
+            start = safeheron::rand::RandomBN(bits - 2) + top;
+            if(!start.IsOdd()) start = start + 1;
+            SmallResidues(start, prime_arr, residue_arr);
+            restart = false;
+        }
+
+        // The j-th candidate is p' = start + 2j. For an odd prime r and s = start mod r,
+        //   r | p'         <=>  j = -s / 2 mod r
+        //   r | 2p' + 1    <=>  j = ((r - 1) / 2 - s) / 2 mod r
+        std::fill(sieve.begin(), sieve.end(), 1);
+        for(size_t t = 0; t < prime_arr.size(); t++){
+            uint64_t r = prime_arr[t];
+            uint64_t s = residue_arr[t];
+            uint64_t inv2 = (r + 1) / 2;
+            uint64_t j0 = (r - s) % r * inv2 % r;
+            uint64_t j1 = ((r - 1) / 2 + r - s) % r * inv2 % r;
+            for(uint64_t j = j0; j < param.interval; j += r) sieve[j] = 0;
+            for(uint64_t j = j1; j < param.interval; j += r) sieve[j] = 0;
+        }
+        stat.sieved_num += param.interval;
+
+        for(uint32_t j = 0; j < param.interval; j++){
+            if(!sieve[j]) continue;
+            if(done.load()) return false;
+            BN pp = start + BN(2 * (long)j);
+            if(pp >= limit){
+                restart = true;
+                break;
+            }
+            stat.tested_num++;
+            BN p = pp * 2 + 1;
+            // Fermat test of p with base 2 rejects almost all the composites with one exponentiation.
+            if(BN(2).PowM(p - 1, p) != 1) continue;
+            if(!pp.IsProbablyPrime() || !p.IsProbablyPrime()) continue;
+            out = p;
+            return true;
+        }
+
+        if(!restart){
+            // Move to the next window.
+            start = start + BN((long)step);
+            for(size_t t = 0; t < prime_arr.size(); t++){
+                residue_arr[t] = (uint32_t)((residue_arr[t] + step) % prime_arr[t]);
+            }
+        }
+    }
+    return false;
+}
+
+/**
+ * Check the parameters and build the table of small odd primes of the sieve.
+ */
+std::vector<uint32_t> SievePrimeTable(size_t bits, const SafePrimeSieveParam &param) {
+    if(bits < 16){
+        throw LocatedException(__FILE__, __LINE__, __FUNCTION__, -1, "bits < 16");
+    }
+    if(param.prime_bound < 3 || param.interval == 0){
+        throw LocatedException(__FILE__, __LINE__, __FUNCTION__, -1, "invalid sieve parameters");
+    }
+    // A small prime must not be able to divide a candidate which is itself prime.
+    uint32_t prime_bound = param.prime_bound;
+    if(bits - 2 < 32 && prime_bound > (1u << (bits - 2))){
+        prime_bound = 1u << (bits - 2);
+    }
+    return SmallOddPrimes(prime_bound);
+}
+
+}
+
+SafePrimeSieveParam DefaultSafePrimeSieveParam(size_t bits) {
+    SafePrimeSieveParam param;
+    if(bits <= 512){
+        param.prime_bound = 1 << 12;
+        param.interval = 1 << 12;
+    }else if(bits <= 1024){
+        param.prime_bound = 1 << 14;
+        param.interval = 1 << 14;
+    }else if(bits <= 1536){
+        param.prime_bound = 1 << 15;
+        param.interval = 1 << 15;
+    }else{
+        param.prime_bound = 1 << 16;
+        param.interval = 1 << 16;
+    }
+    return param;
+}
+
+BN GenerateSafePrime(size_t bits, int thread_num) {
+    SafePrimeSearchStat stat;
+    return GenerateSafePrime(bits, thread_num, DefaultSafePrimeSieveParam(bits), stat);
+}
+
+BN GenerateSafePrime(size_t bits, int thread_num,
+                     const SafePrimeSieveParam &param,
+                     SafePrimeSearchStat &stat) {
+    const std::vector<uint32_t> prime_arr = SievePrimeTable(bits, param);
+    if(thread_num < 1) thread_num = 1;
+
+    stat.sieved_num = 0;
+    stat.tested_num = 0;
+    std::atomic<bool> done(false);
+    std::mutex mutex;
+    bool found = false;
+    BN result;
+    std::exception_ptr error;
+    auto worker = [&]() {
+        SafePrimeSearchStat t_stat = {0, 0};
+        try {
+            BN p;
+            if(SieveSearchSafePrime(bits, param, prime_arr, done, p, t_stat)){
+                std::lock_guard<std::mutex> lock(mutex);
+                if(!found){
+                    result = p;
+                    found = true;
+                }
+            }
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(mutex);
+            if(!error) error = std::current_exception();
+        }
+        done.store(true);
+        std::lock_guard<std::mutex> lock(mutex);
+        stat.sieved_num += t_stat.sieved_num;
+        stat.tested_num += t_stat.tested_num;
+    };
+
+#ifdef SAFEHERON_TSS_RSA_SGX
+    // An enclave can't spawn threads, the calling thread is the only worker.
+    worker();
+#else
+    std::vector<std::thread> thread_arr;
+    try {
+        for(int t = 1; t < thread_num; t++){
+            thread_arr.emplace_back(worker);
+        }
+    } catch (...) {
+        done.store(true);
+        for(auto &t : thread_arr) t.join();
+        throw;
+    }
+    worker();
+    for(auto &t : thread_arr) t.join();
+#endif
+
+    if(!found){
+        if(error) std::rethrow_exception(error);
+        throw LocatedException(__FILE__, __LINE__, __FUNCTION__, -1, "search stopped without a safe prime");
+    }
+    return result;
+}
+
+bool GenerateSafePrime(size_t bits,
+                       const SafePrimeSieveParam &param,
+                       const std::atomic<bool> &cancel,
+                       safeheron::bignum::BN &p) {
+    const std::vector<uint32_t> prime_arr = SievePrimeTable(bits, param);
+    SafePrimeSearchStat stat = {0, 0};
+    return SieveSearchSafePrime(bits, param, prime_arr, cancel, p, stat);
+}
+
+void GenerateSafePrimePair(size_t p_bits, size_t q_bits, int thread_num,
+                           safeheron::bignum::BN &p,
+                           safeheron::bignum::BN &q) {
+#ifdef SAFEHERON_TSS_RSA_SGX
+    // An enclave can't spawn threads.
+    thread_num = 1;
+#endif
+    if(thread_num <= 1){
+        p = GenerateSafePrime(p_bits, 1);
+        do {
+            q = GenerateSafePrime(q_bits, 1);
+        } while (p == q);
+        return;
+    }
+
+#ifndef SAFEHERON_TSS_RSA_SGX
+    // Search q in a second thread while p is searched in this one.
+    int p_thread_num = (thread_num + 1) / 2;
+    int q_thread_num = thread_num - p_thread_num;
+    std::exception_ptr q_error;
+    std::thread q_thread([&]() {
+        try {
+            q = GenerateSafePrime(q_bits, q_thread_num);
+        } catch (...) {
+            q_error = std::current_exception();
+        }
+    });
+    try {
+        p = GenerateSafePrime(p_bits, p_thread_num);
+    } catch (...) {
+        q_thread.join();
+        throw;
+    }
+    q_thread.join();
+    if(q_error) std::rethrow_exception(q_error);
+
+    while(p == q){
+        q = GenerateSafePrime(q_bits, thread_num);
+    }
+#endif
+}
+
+};
+};
@@ -0,0 +1,97 @@
+#ifndef SAFEHERON_TSS_RSA_SAFE_PRIME_H
+#define SAFEHERON_TSS_RSA_SAFE_PRIME_H
+
+#include <atomic>
+#include <cstdint>
+#include "crypto-bn/bn.h"
+
+namespace safeheron {
+namespace tss_rsa{
+
+/**
+ * Parameters of the sieve used by the safe prime search.
+ */
+struct SafePrimeSieveParam{
+    uint32_t prime_bound;  /**< candidates p' or p = 2p' + 1 with an odd factor below prime_bound are sieved out */
+    uint32_t interval;     /**< number of consecutive odd candidates p' sieved at once */
+};
+
+/**
+ * Statistics of a safe prime search.
+ */
+struct SafePrimeSearchStat{
+    uint64_t sieved_num;  /**< number of candidates which went through the sieve */
+    uint64_t tested_num;  /**< number of candidates which survived the sieve and were tested for primality */
+};
+
+/**
+ * Default sieve parameters for safe primes of "bits" bits.
+ *
+ * Larger primes make the primality tests more expensive, so a larger table of small primes pays off.
+ * @param[in] bits bit length of p.
+ * @return the sieve parameters.
+ */
+SafePrimeSieveParam DefaultSafePrimeSieveParam(size_t bits);
+
+/**
+ * Generate a random safe prime p = 2p' + 1 of "bits" bits.
+ *
+ * Each worker starts at a random odd p' and walks through the following odd numbers. A window of
+ * "interval" candidates is sieved at once by every small odd prime r < prime_bound, removing p'
+ * with p' = 0 mod r and p' with p = 2p' + 1 = 0 mod r. The residues of the window start are updated
+ * incrementally when the worker moves to the next window. Only the survivors go to a Fermat test
+ * of p and then to the Miller-Rabin tests of p' and p.
+ *
+ * With thread_num > 1 the workers run at the same time. The first worker which finds a safe prime
+ * wins, and the others stop after their current candidate.
+ * In the SGX build the search always runs in the calling thread.
+ * @param[in] bits bit length of p.
+ * @param[in] thread_num number of workers, 1 to search in the calling thread.
+ * @return a safe prime.
+ */
+safeheron::bignum::BN GenerateSafePrime(size_t bits, int thread_num);
+
+/**
+ * Generate a random safe prime p = 2p' + 1 of "bits" bits with specified sieve parameters.
+ * @param[in] bits bit length of p.
+ * @param[in] thread_num number of workers, 1 to search in the calling thread.
+ * @param[in] param sieve parameters.
+ * @param[out] stat statistics of the search, summed over all the workers.
+ * @return a safe prime.
+ */
+safeheron::bignum::BN GenerateSafePrime(size_t bits, int thread_num,
+                                        const SafePrimeSieveParam &param,
+                                        SafePrimeSearchStat &stat);
+
+/**
+ * Generate a random safe prime p = 2p' + 1 of "bits" bits in the calling thread, unless the search is
+ * cancelled by another thread.
+ * @param[in] bits bit length of p.
+ * @param[in] param sieve parameters.
+ * @param[in] cancel the search stops after the current candidate once it is set.
+ * @param[out] p a safe prime.
+ * @return true if p is a safe prime, false if the search was cancelled.
+ */
+bool GenerateSafePrime(size_t bits,
+                       const SafePrimeSieveParam &param,
+                       const std::atomic<bool> &cancel,
+                       safeheron::bignum::BN &p);
+
+/**
+ * Generate two random safe primes p and q, p != q, at the same time.
+ *
+ * The workers are split between the two searches.
+ * @param[in] p_bits bit length of p.
+ * @param[in] q_bits bit length of q.
+ * @param[in] thread_num total number of workers.
+ * @param[out] p a safe prime of p_bits bits.
+ * @param[out] q a safe prime of q_bits bits.
+ */
+void GenerateSafePrimePair(size_t p_bits, size_t q_bits, int thread_num,
+                           safeheron::bignum::BN &p,
+                           safeheron::bignum::BN &q);
+
+};
+};
+
+#endif //SAFEHERON_TSS_RSA_SAFE_PRIME_H
@@ -0,0 +1,93 @@
+#ifndef SAFEHERON_TSS_RSA_SCOPED_BN_H
+#define SAFEHERON_TSS_RSA_SCOPED_BN_H
+
+#include <string>
+#include <vector>
+#include <openssl/bn.h>
+#include <openssl/crypto.h>
+#include "crypto-bn/bn.h"
+#include "exception/located_exception.h"
+
+/**
+ * RAII holders of OpenSSL big number objects, shared by the implementations which work on
+ * BIGNUM directly. Internal header, not part of the public API.
+ */
+
+namespace safeheron {
+namespace tss_rsa{
+
+/**
+ * RAII holder of a BN_CTX.
+ */
+class ScopedBNCtx{
+public:
+    ScopedBNCtx() : ctx_(BN_CTX_new()) {
+        if(!ctx_) throw safeheron::exception::LocatedException(__FILE__, __LINE__, __FUNCTION__, -1, "BN_CTX_new failed");
+    }
+    ~ScopedBNCtx() { BN_CTX_free(ctx_); }
+    BN_CTX *get() const { return ctx_; }
+private:
+    ScopedBNCtx(const ScopedBNCtx &);
+    ScopedBNCtx &operator=(const ScopedBNCtx &);
+    BN_CTX *ctx_;
+};
+
+/**
+ * RAII holder of a BIGNUM. The value is wiped on destruction.
+ */
+class ScopedBIGNUM{
+public:
+    ScopedBIGNUM() : bn_(BN_new()) {
+        if(!bn_) throw safeheron::exception::LocatedException(__FILE__, __LINE__, __FUNCTION__, -1, "BN_new failed");
+    }
+    explicit ScopedBIGNUM(const safeheron::bignum::BN &num) : ScopedBIGNUM() {
+        std::string buf;
+        if(num.IsNeg()){
+            num.Neg().ToBytesBE(buf);
+        }else{
+            num.ToBytesBE(buf);
+        }
+        BN_bin2bn(reinterpret_cast<const unsigned char *>(buf.data()), (int)buf.size(), bn_);
+        BN_set_negative(bn_, num.IsNeg() ? 1 : 0);
+        OPENSSL_cleanse(&buf[0], buf.size());
+    }
+    ~ScopedBIGNUM() { BN_clear_free(bn_); }
+    BIGNUM *get() const { return bn_; }
+    safeheron::bignum::BN ToBN() const {
+        std::string buf(BN_num_bytes(bn_), '\0');
+        BN_bn2bin(bn_, reinterpret_cast<unsigned char *>(&buf[0]));
+        safeheron::bignum::BN ret = safeheron::bignum::BN::FromBytesBE(buf);
+        OPENSSL_cleanse(&buf[0], buf.size());
+        return BN_is_negative(bn_) ? ret.Neg() : ret;
+    }
+private:
+    ScopedBIGNUM(const ScopedBIGNUM &);
+    ScopedBIGNUM &operator=(const ScopedBIGNUM &);
+    BIGNUM *bn_;
+};
+
+/**
+ * RAII holder of an array of BIGNUM.
+ */
+class BIGNUMArray{
+public:
+    BIGNUMArray() {}
+    ~BIGNUMArray() {
+        for(BIGNUM *item : arr_) BN_clear_free(item);
+    }
+    BIGNUM *New() {
+        BIGNUM *item = BN_new();
+        if(!item) throw safeheron::exception::LocatedException(__FILE__, __LINE__, __FUNCTION__, -1, "BN_new failed");
+        arr_.push_back(item);
+        return item;
+    }
+private:
+    BIGNUMArray(const BIGNUMArray &);
+    BIGNUMArray &operator=(const BIGNUMArray &);
+    std::vector<BIGNUM *> arr_;
+};
+
+};
+};
+
+#endif //SAFEHERON_TSS_RSA_SCOPED_BN_H
@@ -1,10 +1,13 @@
 #include "tss_rsa.h"
+#include <algorithm>
 #include "crypto-bn/rand.h"
 #include "exception/located_exception.h"
 #include "crypto-sss/vsss.h"
 #include "crypto-hash/hash256.h"
 #include "common.h"
 #include "RSASigShareProof.h"
+#include "Combiner.h"
+#include "safe_prime.h"
 
 using safeheron::bignum::BN;
 using safeheron::exception::LocatedException;
@@ -101,6 +104,13 @@ bool GenerateKey(size_t key_bits_length, int l, int k,
                  std::vector<RSAPrivateKeyShare> &private_key_share_arr,
                  RSAPublicKey &public_key,
                  RSAKeyMeta &key_meta){
+    return GenerateKey(key_bits_length, l, k, 1, private_key_share_arr, public_key, key_meta);
+}
+
+bool GenerateKey(size_t key_bits_length, int l, int k, int thread_num,
+                 std::vector<RSAPrivateKeyShare> &private_key_share_arr,
+                 RSAPublicKey &public_key,
+                 RSAKeyMeta &key_meta){
     // check key_bits_length
     if( (key_bits_length != 1024) && (key_bits_length != 2048) && (key_bits_length != 3072) && (key_bits_length != 4096)){
         return false;
@@ -114,14 +124,9 @@ bool GenerateKey(size_t key_bits_length, int l, int k,
     // default value
     int e = f4;
 
-    // p = 2p' + 1
-    BN p = safeheron::rand::RandomSafePrime(key_bits_length / 2);
-
-    // q = 2q' + 1, make sure: p != q
-    BN q;
-    do {
-        q = safeheron::rand::RandomSafePrime(key_bits_length / 2 - 1);
-    } while (p == q);
+    // p = 2p' + 1, q = 2q' + 1, make sure: p != q
+    BN p, q;
+    GenerateSafePrimePair(key_bits_length / 2, key_bits_length / 2 - 1, thread_num, p, q);
 
     // n = p * q
     BN n = p * q;
@@ -138,23 +143,25 @@ bool GenerateKey(size_t key_bits_length, int l, int k,
 }
 
 
+class SafePrimePool;
+
 /**
- * Generate private key shares, public key, key meta data with specified parameters.
- *
- * @param[in] key_bits_length: 1024/2048/3072/4096.  4096 is advised.
- * @param[in] l: total number of private key shares.
- * @param[in] k: threshold, k < l and k >= (l/2+1)
- * @param[in] param: specified parameters.
- * @param[out] private_key_share_arr[out]: shares of private key.
- * @param[out] public_key[out]: public key.
- * @param[out] key_meta[out]: key meta data.
- * @return true on success, false on error.
+ * Take a safe prime of "bits" bits from the pool if there is one, or search it with thread_num workers.
  */
-bool GenerateKeyEx(size_t key_bits_length, int l, int k,
-                   const KeyGenParam &_param,
-                   std::vector<RSAPrivateKeyShare> &private_key_share_arr,
-                   RSAPublicKey &public_key,
-                   RSAKeyMeta &key_meta){
+static BN TakeSafePrime(SafePrimePool *pool, size_t bits, int thread_num){
+#ifndef SAFEHERON_TSS_RSA_SGX
+    if(pool) return pool->Take(bits);
+#endif
+    return GenerateSafePrime(bits, thread_num);
+}
+
+static bool InternalGenerateKeyEx(size_t key_bits_length, int l, int k,
+                                  const KeyGenParam &_param,
+                                  int thread_num,
+                                  SafePrimePool *pool,
+                                  std::vector<RSAPrivateKeyShare> &private_key_share_arr,
+                                  RSAPublicKey &public_key,
+                                  RSAKeyMeta &key_meta){
     // check k, l
     if(l <= 1 || k <= 0 || k < (l/2+1) || k > l){
         return false;
@@ -171,29 +178,40 @@ bool GenerateKeyEx(size_t key_bits_length, int l, int k,
         }
     }
 
-    // check p: p = 2p' + 1
-    if(param.p() == 0){
-        BN p = safeheron::rand::RandomSafePrime(key_bits_length/ 2);
-        param.set_p(p);
-    }else{
-        BN pp = (param.p() - 1)/2;
-        if(!param.p().IsProbablyPrime() || !pp.IsProbablyPrime()){
-            return false;
-        }
-    }
+    const size_t p_bits = key_bits_length / 2;
+    const size_t q_bits = key_bits_length / 2 - 1;
 
+    // check p: p = 2p' + 1
     // check q: q = 2q' + 1
     // make sure: q != p
-    if(param.q() == 0){
-        BN q;
-        do {
-            q = safeheron::rand::RandomSafePrime(key_bits_length / 2 - 1);
-        }while (q == param.p());
+    if(param.p() == 0 && param.q() == 0 && !pool){
+        // generate p and q at the same time
+        BN p, q;
+        GenerateSafePrimePair(p_bits, q_bits, thread_num, p, q);
+        param.set_p(p);
         param.set_q(q);
     }else{
-        BN qq = (param.q() - 1)/2;
-        if(!param.q().IsProbablyPrime() || !qq.IsProbablyPrime()){
-            return false;
+        if(param.p() == 0){
+            BN p = TakeSafePrime(pool, p_bits, thread_num);
+            param.set_p(p);
+        }else{
+            BN pp = (param.p() - 1)/2;
+            if(!param.p().IsProbablyPrime() || !pp.IsProbablyPrime()){
+                return false;
+            }
+        }
+
+        if(param.q() == 0){
+            BN q;
+            do {
+                q = TakeSafePrime(pool, q_bits, thread_num);
+            }while (q == param.p());
+            param.set_q(q);
+        }else{
+            BN qq = (param.q() - 1)/2;
+            if(!param.q().IsProbablyPrime() || !qq.IsProbablyPrime()){
+                return false;
+            }
         }
     }
 
@@ -228,41 +246,108 @@ bool GenerateKeyEx(size_t key_bits_length, int l, int k,
     return InternalGenerateKey(key_bits_length, l, k, private_key_share_arr, public_key, key_meta, param);
 }
 
+/**
+ * Generate private key shares, public key, key meta data with specified parameters.
+ *
+ * @param[in] key_bits_length: 1024/2048/3072/4096.  4096 is advised.
+ * @param[in] l: total number of private key shares.
+ * @param[in] k: threshold, k < l and k >= (l/2+1)
+ * @param[in] param: specified parameters.
+ * @param[out] private_key_share_arr[out]: shares of private key.
+ * @param[out] public_key[out]: public key.
+ * @param[out] key_meta[out]: key meta data.
+ * @return true on success, false on error.
+ */
+bool GenerateKeyEx(size_t key_bits_length, int l, int k,
+                   const KeyGenParam &param,
+                   std::vector<RSAPrivateKeyShare> &private_key_share_arr,
+                   RSAPublicKey &public_key,
+                   RSAKeyMeta &key_meta){
+    return GenerateKeyEx(key_bits_length, l, k, param, 1, private_key_share_arr, public_key, key_meta);
+}
+
+bool GenerateKeyEx(size_t key_bits_length, int l, int k,
+                   const KeyGenParam &param,
+                   int thread_num,
+                   std::vector<RSAPrivateKeyShare> &private_key_share_arr,
+                   RSAPublicKey &public_key,
+                   RSAKeyMeta &key_meta){
+    return InternalGenerateKeyEx(key_bits_length, l, k, param, thread_num, nullptr, private_key_share_arr, public_key, key_meta);
+}
+
+#ifndef SAFEHERON_TSS_RSA_SGX
+bool GenerateKeyEx(size_t key_bits_length, int l, int k,
+                   const KeyGenParam &param,
+                   SafePrimePool &pool,
+                   std::vector<RSAPrivateKeyShare> &private_key_share_arr,
+                   RSAPublicKey &public_key,
+                   RSAKeyMeta &key_meta){
+    return InternalGenerateKeyEx(key_bits_length, l, k, param, 1, &pool, private_key_share_arr, public_key, key_meta);
+}
+#endif
 
 /**
- * Combine all the shares of signature to make a real signature.
+ * Number of validation keys of the key meta data, for "InternalCombineSignatures".
+ */
+static size_t VkiNum(const RSAKeyMeta &key_meta){
+    return key_meta.vki_arr().size();
+}
+
+static size_t VkiNum(const RSAKeyMetaView &key_meta){
+    return key_meta.vki_num();
+}
+
+/**
+ * Combine all the shares of signature to make a real signature, for a one-shot call.
+ *
+ * Unlike "Combiner", nothing is computed for later calls: vku^e and vku^{-1} are only computed
+ * if the Jacobi symbol of the message is -1, and the proofs are verified one by one. Only the
+ * validation keys of the signers are read, so a "RSAKeyMetaView" decodes k of them.
  * @param[in] x: a big number related to prepared hash
  * @param[in] sig_arr : the shares of signature.
  * @param[in] public_key: public key.
- * @param[in] key_meta: key meta data.
+ * @param[in] key_meta: key meta data, a "RSAKeyMeta" or a "RSAKeyMetaView".
+ * @param[in] validate_sig: whether to verify the proofs of signature shares.
  * @param[out] out_sig: a real signature.
  * @return true on success, false on error.
  */
-bool InternalCombineSignatures(const safeheron::bignum::BN &_x,
-                               const std::vector<RSASigShare> &sig_arr,
-                               const RSAPublicKey &public_key,
-                               const RSAKeyMeta &key_meta,
-                               const bool validate_sig,
-                               safeheron::bignum::BN &out_sig){
-    // e' is always set to 4.
-    BN ep(4);
+template<typename KeyMeta>
+static bool InternalCombineSignatures(const safeheron::bignum::BN &_x,
+                                      const std::vector<RSASigShare> &sig_arr,
+                                      const RSAPublicKey &public_key,
+                                      const KeyMeta &key_meta,
+                                      bool validate_sig,
+                                      safeheron::bignum::BN &out_sig){
+    // S should be a subset of (1, ... ,l) without duplicates
+    std::vector<int> index_arr;
+    for(const auto &item : sig_arr){
+        if(item.index() < 1 || item.index() > key_meta.l() || (size_t)item.index() > VkiNum(key_meta)) return false;
+        index_arr.push_back(item.index());
+    }
+    std::sort(index_arr.begin(), index_arr.end());
+    if(index_arr.empty() || std::adjacent_find(index_arr.begin(), index_arr.end()) != index_arr.end()) return false;
+
+    MontContext mont_n(public_key.n());
 
     // x = m    , if (m, n) == 1
     // x = m*u^e, if (m, n) == -1
     BN x = _x;
     int jacobi_m_n = BN::JacobiSymbol(x, public_key.n());
     if( jacobi_m_n == -1){
-        x = (x * key_meta.vku().PowM(public_key.e(), public_key.n())) % public_key.n();
+        x = mont_n.MulM(x, mont_n.PowM(key_meta.vku(), public_key.e()));
     }
 
     // Validate signature share
     if(validate_sig) {
-        bool is_valid_sig = true;
         for (const auto &sig: sig_arr) {
             RSASigShareProof proof(sig.z(), sig.c());
-            is_valid_sig &= proof.Verify(key_meta.vkv(), key_meta.vki(sig.index() - 1), x, public_key.n(),
-                                         sig.sig_share());
-            if (!is_valid_sig) return false;
+            bool ok = false;
+            try {
+                ok = proof.Verify(key_meta.vkv(), key_meta.vki(sig.index() - 1), x, mont_n, sig.sig_share());
+            } catch (const LocatedException &e) {
+                ok = false;
+            }
+            if (!ok) return false;
         }
     }
 
@@ -272,25 +357,28 @@ bool InternalCombineSignatures(const safeheron::bignum::BN &_x,
         delta *= i;
     }
 
-    // S is a subset of (1, ... ,l)
+    // 4a + eb = 1, e' is always set to 4.
+    BN ep(4);
+    BN d, a, b;
+    BN::ExtendedEuclidean(ep, public_key.e(), a, b, d);
+
+    // y = x_{i_1}^{2a \lambda_{0,i_1}^S} \dots x_{i_k}^{2a \lambda_{0,i_k}^S} x^b \pmod n
     std::vector<BN> S;
-    for(const auto &item : sig_arr){
-        S.emplace_back(BN(item.index()));
+    for(int index : index_arr){
+        S.emplace_back(BN(index));
     }
-
-    // w = x_{i_1}^{2 \lambda_{0,i_1}^S} \dots	x_{i_k}^{2 \lambda_{0,i_k}^S} \pmod n
-    BN w(1);
+    std::vector<BN> base_arr;
+    std::vector<BN> power_arr;
     for(const auto &item : sig_arr){
         BN lam = lambda(BN(0), BN(item.index()), S, delta);
-        w = (w * item.sig_share().PowM(lam * 2, public_key.n())) % public_key.n();
+        base_arr.push_back(item.sig_share());
+        power_arr.push_back(lam * 2 * a);
     }
-
-    // y = w^a x^b \pmod n
-    BN d, a, b;
-    BN::ExtendedEuclidean(ep, public_key.e(), a, b, d);
-    BN y = w.PowM(a, public_key.n()) * x.PowM(b, public_key.n()) % public_key.n();
+    base_arr.push_back(x);
+    power_arr.push_back(b);
+    BN y = mont_n.MultiPowM(base_arr, power_arr);
     if (jacobi_m_n == -1) {
-        y = (y * key_meta.vku().InvM(public_key.n())) % public_key.n();
+        y = mont_n.MulM(y, key_meta.vku().InvM(public_key.n()));
     }
     out_sig = y;
     return true;
@@ -314,6 +402,24 @@ bool CombineSignatures(const std::string &doc,
     return InternalCombineSignatures(x, sig_arr, public_key, key_meta, true, out_sig);
 }
 
+/**
+ * Combine all the shares of signature to make a real signature, with a view of the key meta data.
+ * @param[in] doc: doc
+ * @param[in] sig_arr : the shares of signature.
+ * @param[in] public_key: public key.
+ * @param[in] key_meta: view of the key meta data.
+ * @param[out] out_sig: a real signature.
+ * @return true on success, false on error.
+ */
+bool CombineSignatures(const std::string &doc,
+                       const std::vector<RSASigShare> &sig_arr,
+                       const RSAPublicKey &public_key,
+                       const RSAKeyMetaView &key_meta,
+                       safeheron::bignum::BN &out_sig){
+    BN x = BN::FromBytesBE(doc);
+    return InternalCombineSignatures(x, sig_arr, public_key, key_meta, true, out_sig);
+}
+
 /**
  * Combine all the shares of signature without validation on signature shares to make a real signature.
  * @param[in] doc: doc
@@ -332,5 +438,45 @@ bool CombineSignaturesWithoutValidation(const std::string &doc,
     return InternalCombineSignatures(x, sig_arr, public_key, key_meta, false, out_sig);
 }
 
+/**
+ * Combine the shares of signature optimistically.
+ * @param[in] doc: doc
+ * @param[in] sig_arr : the shares of signature, at least k of them, and any spare ones.
+ * @param[in] public_key: public key.
+ * @param[in] key_meta: key meta data.
+ * @param[out] out_sig: a real signature.
+ * @param[out] invalid_arr : positions in sig_arr of the shares with an invalid proof.
+ * @return true on success, false if there are not k valid shares.
+ */
+bool CombineSignaturesOptimistic(const std::string &doc,
+                                 const std::vector<RSASigShare> &sig_arr,
+                                 const RSAPublicKey &public_key,
+                                 const RSAKeyMeta &key_meta,
+                                 safeheron::bignum::BN &out_sig,
+                                 std::vector<size_t> &invalid_arr){
+    return Combiner(public_key, key_meta).CombineSignaturesOptimistic(doc, sig_arr, out_sig, invalid_arr);
+}
+
+/**
+ * Combine the shares of signature of many documents under the same key.
+ * @param[in] doc_arr: documents.
+ * @param[in] sig_arr_arr : sig_arr_arr[d] are the shares of signature of doc_arr[d].
+ * @param[in] public_key: public key.
+ * @param[in] key_meta: key meta data.
+ * @param[in] thread_num: number of threads, 1 to combine in the calling thread.
+ * @param[out] out_sig_arr: out_sig_arr[d] is the real signature of doc_arr[d], or 0 if it failed.
+ * @param[out] failed_arr: positions in doc_arr of the documents which could not be combined.
+ * @return true if all the documents are combined, false otherwise.
+ */
+bool CombineSignaturesBatch(const std::vector<std::string> &doc_arr,
+                            const std::vector<std::vector<RSASigShare>> &sig_arr_arr,
+                            const RSAPublicKey &public_key,
+                            const RSAKeyMeta &key_meta,
+                            int thread_num,
+                            std::vector<safeheron::bignum::BN> &out_sig_arr,
+                            std::vector<size_t> &failed_arr){
+    return Combiner(public_key, key_meta).CombineSignaturesBatch(doc_arr, sig_arr_arr, thread_num, out_sig_arr, failed_arr);
+}
+
 };
 };
@@ -5,8 +5,19 @@
 #include "RSAPublicKey.h"
 #include "RSASigShare.h"
 #include "RSAKeyMeta.h"
+#include "RSAKeyMetaView.h"
 #include "KeyGenParam.h"
 #include "emsa_pss.h"
+#include "emsa_pkcs1_v1_5.h"
+#include "SigningContext.h"
+#include "Combiner.h"
+#include "CombineSession.h"
+#include "FixedBaseTable.h"
+#include "safe_prime.h"
+#ifndef SAFEHERON_TSS_RSA_SGX
+#include "SafePrimePool.h"
+#include "ProofCommitmentPool.h"
+#endif
 #include <vector>
 
 namespace safeheron {
@@ -28,13 +39,51 @@ bool GenerateKey(size_t key_bits_length, int l, int k,
                  RSAPublicKey &public_key,
                  RSAKeyMeta &key_meta);
 
+/**
+ * Generate private key shares, public key, key meta data.
+ *
+ * The safe primes p and q are searched at the same time by thread_num workers in total.
+ * @param[in] key_bits_length: 2048, 3072, 4096 is advised.
+ * @param[in] l: total number of private key shares.
+ * @param[in] k: threshold, k < l and k >= (l/2+1)
+ * @param[in] thread_num: number of threads used to search the safe primes.
+ * @param[out] private_key_share_arr: shares of private key.
+ * @param[out] public_key: public key.
+ * @param[out] key_meta: key meta data.
+ * @return true on success, false on error.
+ */
+bool GenerateKey(size_t key_bits_length, int l, int k, int thread_num,
+                 std::vector<RSAPrivateKeyShare> &private_key_share_arr,
+                 RSAPublicKey &public_key,
+                 RSAKeyMeta &key_meta);
+
+/**
+ * Generate private key shares, public key, key meta data with specified parameters.
+ *
+ * @param[in] key_bits_length: 2048, 3072, 4096 is advised.
+ * @param[in] l: total number of private key shares.
+ * @param[in] k: threshold, k < l and k >= (l/2+1)
+ * @param[in] param: specified parameters.
+ * @param[out] private_key_share_arr: shares of private key.
+ * @param[out] public_key: public key.
+ * @param[out] key_meta: key meta data.
+ * @return true on success, false on error.
+ */
+bool GenerateKeyEx(size_t key_bits_length, int l, int k,
+                   const KeyGenParam &param,
+                   std::vector<RSAPrivateKeyShare> &private_key_share_arr,
+                   RSAPublicKey &public_key,
+                   RSAKeyMeta &key_meta);
+
 /**
  * Generate private key shares, public key, key meta data with specified parameters.
  *
+ * The missing safe primes are searched by thread_num workers in total.
  * @param[in] key_bits_length: 2048, 3072, 4096 is advised.
  * @param[in] l: total number of private key shares.
  * @param[in] k: threshold, k < l and k >= (l/2+1)
  * @param[in] param: specified parameters.
+ * @param[in] thread_num: number of threads used to search the safe primes.
  * @param[out] private_key_share_arr: shares of private key.
  * @param[out] public_key: public key.
  * @param[out] key_meta: key meta data.
@@ -42,12 +91,39 @@ bool GenerateKey(size_t key_bits_length, int l, int k,
  */
 bool GenerateKeyEx(size_t key_bits_length, int l, int k,
                    const KeyGenParam &param,
+                   int thread_num,
                    std::vector<RSAPrivateKeyShare> &private_key_share_arr,
                    RSAPublicKey &public_key,
                    RSAKeyMeta &key_meta);
 
+#ifndef SAFEHERON_TSS_RSA_SGX
+/**
+ * Generate private key shares, public key, key meta data with specified parameters.
+ *
+ * The missing safe primes are taken from the pool, which should pool the bit lengths
+ * key_bits_length / 2 and key_bits_length / 2 - 1. A safe prime is generated in the calling thread
+ * when its queue is empty.
+ * @param[in] key_bits_length: 2048, 3072, 4096 is advised.
+ * @param[in] l: total number of private key shares.
+ * @param[in] k: threshold, k < l and k >= (l/2+1)
+ * @param[in] param: specified parameters.
+ * @param[in] pool: pool of pre-generated safe primes.
+ * @param[out] private_key_share_arr: shares of private key.
+ * @param[out] public_key: public key.
+ * @param[out] key_meta: key meta data.
+ * @return true on success, false on error.
+ */
+bool GenerateKeyEx(size_t key_bits_length, int l, int k,
+                   const KeyGenParam &param,
+                   SafePrimePool &pool,
+                   std::vector<RSAPrivateKeyShare> &private_key_share_arr,
+                   RSAPublicKey &public_key,
+                   RSAKeyMeta &key_meta);
+#endif
+
 /**
  * Combine all the shares of signature to make a real signature.
+ * @note Nothing is kept for later calls, keep a "Combiner" to combine many documents under one key.
  * @param[in] doc: doc
  * @param[in] sig_arr : the shares of signature.
  * @param[in] public_key: public key.
@@ -61,6 +137,22 @@ bool CombineSignatures(const std::string &doc,
                        const RSAKeyMeta &key_meta,
                        safeheron::bignum::BN &out_sig);
 
+/**
+ * Combine all the shares of signature to make a real signature, with a view of the key meta data.
+ * @note Only the validation keys of the signers in sig_arr are decoded from the view.
+ * @param[in] doc: doc
+ * @param[in] sig_arr : the shares of signature.
+ * @param[in] public_key: public key.
+ * @param[in] key_meta: view of the key meta data.
+ * @param[out] out_sig: a real signature.
+ * @return true on success, false on error.
+ */
+bool CombineSignatures(const std::string &doc,
+                       const std::vector<RSASigShare> &sig_arr,
+                       const RSAPublicKey &public_key,
+                       const RSAKeyMetaView &key_meta,
+                       safeheron::bignum::BN &out_sig);
+
 
 /**
  * Combine all the shares of signature without validation on signature shares to make a real signature.
@@ -78,6 +170,46 @@ bool CombineSignaturesWithoutValidation(const std::string &doc,
                                         const RSAKeyMeta &key_meta,
                                         safeheron::bignum::BN &out_sig);
 
+/**
+ * Combine the shares of signature optimistically: combine k shares without validation, check the
+ * signature with the public key, and only verify the proofs of the shares if the check fails.
+ * See "Combiner::CombineSignaturesOptimistic".
+ * @param[in] doc: doc
+ * @param[in] sig_arr : the shares of signature, at least k of them, and any spare ones.
+ * @param[in] public_key: public key.
+ * @param[in] key_meta: key meta data.
+ * @param[out] out_sig: a real signature.
+ * @param[out] invalid_arr : positions in sig_arr of the shares with an invalid proof.
+ * @return true on success, false if there are not k valid shares.
+ */
+bool CombineSignaturesOptimistic(const std::string &doc,
+                                 const std::vector<RSASigShare> &sig_arr,
+                                 const RSAPublicKey &public_key,
+                                 const RSAKeyMeta &key_meta,
+                                 safeheron::bignum::BN &out_sig,
+                                 std::vector<size_t> &invalid_arr);
+
+/**
+ * Combine the shares of signature of many documents under the same key.
+ * @note It prepares a "Combiner" of the key for this call only. Keep a "Combiner" to combine
+ *       repeatedly under the same key.
+ * @param[in] doc_arr: documents.
+ * @param[in] sig_arr_arr : sig_arr_arr[d] are the shares of signature of doc_arr[d].
+ * @param[in] public_key: public key.
+ * @param[in] key_meta: key meta data.
+ * @param[in] thread_num: number of threads, 1 to combine in the calling thread.
+ * @param[out] out_sig_arr: out_sig_arr[d] is the real signature of doc_arr[d], or 0 if it failed.
+ * @param[out] failed_arr: positions in doc_arr of the documents which could not be combined.
+ * @return true if all the documents are combined, false otherwise.
+ */
+bool CombineSignaturesBatch(const std::vector<std::string> &doc_arr,
+                            const std::vector<std::vector<RSASigShare>> &sig_arr_arr,
+                            const RSAPublicKey &public_key,
+                            const RSAKeyMeta &key_meta,
+                            int thread_num,
+                            std::vector<safeheron::bignum::BN> &out_sig_arr,
+                            std::vector<size_t> &failed_arr);
+
 
 };
 };
@@ -1,8 +1,12 @@
+#include <algorithm>
+#include <chrono>
+#include <thread>
 #include "gtest/gtest.h"
 #include "crypto-bn/bn.h"
 #include "crypto-bn/rand.h"
 #include "exception/safeheron_exceptions.h"
 #include "crypto-tss-rsa/tss_rsa.h"
+#include "crypto-tss-rsa/RSASigShareProof.h"
 
 using safeheron::bignum::BN;
 using safeheron::tss_rsa::RSAPrivateKeyShare;
@@ -10,11 +14,44 @@ using safeheron::tss_rsa::RSAPublicKey;
 using safeheron::tss_rsa::RSAKeyMeta;
 using safeheron::tss_rsa::RSASigShare;
 using safeheron::tss_rsa::KeyGenParam;
+using safeheron::tss_rsa::SigningContext;
+using safeheron::tss_rsa::Combiner;
+using safeheron::tss_rsa::MontContext;
+using safeheron::tss_rsa::FixedBaseTable;
+using safeheron::tss_rsa::RSASigShareProof;
 using safeheron::exception::LocatedException;
 using safeheron::exception::OpensslException;
 using safeheron::exception::BadAllocException;
 using safeheron::exception::RandomSourceException;
 
+/**
+ * Fixture of the tests with a 1024-bit key of threshold K out of L.
+ * The key is generated once for all the tests of the fixture.
+ */
+template<int K, int L>
+class KeyTest : public ::testing::Test {
+protected:
+    static void SetUpTestCase() {
+        priv_arr.clear();
+        ASSERT_TRUE(safeheron::tss_rsa::GenerateKey(1024, L, K, priv_arr, pub, key_meta));
+    }
+
+    static const int k = K;
+    static const int l = L;
+    static std::vector<RSAPrivateKeyShare> priv_arr;
+    static RSAPublicKey pub;
+    static RSAKeyMeta key_meta;
+};
+
+template<int K, int L> const int KeyTest<K, L>::k;
+template<int K, int L> const int KeyTest<K, L>::l;
+template<int K, int L> std::vector<RSAPrivateKeyShare> KeyTest<K, L>::priv_arr;
+template<int K, int L> RSAPublicKey KeyTest<K, L>::pub;
+template<int K, int L> RSAKeyMeta KeyTest<K, L>::key_meta;
+
+typedef KeyTest<2, 3> TSS_RSA_2_3;
+typedef KeyTest<3, 5> TSS_RSA_3_5;
+
 TEST(TSS_RSA, KeyGen2_3_Sign_3_3) {
     std::string json_str;
     std::string doc("12345678123456781234567812345678");
@@ -177,6 +214,759 @@ TEST(TSS_RSA, KeyGenEx2_3_Sign_2_3) {
     EXPECT_TRUE(pub.VerifySignature(doc, sig));
 }
 
+TEST_F(TSS_RSA_2_3, SigningContext_Sign) {
+    std::string doc("12345678123456781234567812345678");
+
+    // Prepare the signing contexts once, then sign with them.
+    std::vector<SigningContext> ctx_arr;
+    for(int i = 0; i < l; i++) {
+        ctx_arr.emplace_back(priv_arr[i], key_meta, pub);
+    }
+    std::vector<RSASigShare> sig_share_arr;
+    sig_share_arr.push_back(ctx_arr[0].Sign(doc));
+    sig_share_arr.push_back(ctx_arr[2].Sign(doc));
+
+    // The signature share is the same as the one of "RSAPrivateKeyShare::Sign".
+    EXPECT_TRUE(sig_share_arr[0].sig_share() == priv_arr[0].Sign(doc, key_meta, pub).sig_share());
+
+    // "SignLowLatency" makes the same signature share, with a valid proof.
+    RSASigShare sig_share = ctx_arr[1].SignLowLatency(doc);
+    EXPECT_TRUE(sig_share.sig_share() == priv_arr[1].Sign(doc, key_meta, pub).sig_share());
+    std::vector<size_t> invalid_arr;
+    EXPECT_TRUE(Combiner(pub, key_meta).VerifySigShares(doc, {sig_share_arr[0], sig_share}, invalid_arr));
+
+    BN sig;
+    bool status = safeheron::tss_rsa::CombineSignatures(doc, sig_share_arr, pub, key_meta, sig);
+    EXPECT_TRUE(status);
+
+    // Verify the final signature.
+    EXPECT_TRUE(pub.VerifySignature(doc, sig));
+}
+
+TEST_F(TSS_RSA_2_3, Combiner) {
+    std::string doc("12345678123456781234567812345678");
+
+    std::vector<RSASigShare> sig_share_arr;
+    for(int i = 0; i < l; i++) {
+        sig_share_arr.push_back(priv_arr[i].Sign(doc, key_meta, pub));
+    }
+
+    // The combiner is built once per key and reused for every signer set.
+    Combiner combiner(pub, key_meta);
+    std::vector< std::vector<RSASigShare>> subset_arr = {
+            {sig_share_arr[0], sig_share_arr[1]},
+            {sig_share_arr[2], sig_share_arr[0]},
+            {sig_share_arr[0], sig_share_arr[1], sig_share_arr[2]},
+            {sig_share_arr[1], sig_share_arr[0]},
+    };
+    for(const auto &subset : subset_arr) {
+        BN sig, expected_sig;
+        EXPECT_TRUE(combiner.CombineSignatures(doc, subset, sig));
+        EXPECT_TRUE(pub.VerifySignature(doc, sig));
+        EXPECT_TRUE(combiner.CombineSignaturesWithoutValidation(doc, subset, sig));
+        EXPECT_TRUE(safeheron::tss_rsa::CombineSignaturesWithoutValidation(doc, subset, pub, key_meta, expected_sig));
+        EXPECT_TRUE(sig == expected_sig);
+    }
+
+    // Duplicated signers are rejected.
+    BN sig;
+    std::vector<RSASigShare> duplicated_arr = {sig_share_arr[0], sig_share_arr[0]};
+    EXPECT_FALSE(combiner.CombineSignaturesWithoutValidation(doc, duplicated_arr, sig));
+    EXPECT_FALSE(safeheron::tss_rsa::CombineSignaturesWithoutValidation(doc, duplicated_arr, pub, key_meta, sig));
+}
+
+TEST(TSS_RSA, MontContext_MultiPowM) {
+    BN n = safeheron::rand::RandomPrime(512) * safeheron::rand::RandomPrime(512);
+    MontContext mont_n(n);
+    for(int k = 1; k <= 7; k++) {
+        std::vector<BN> base_arr;
+        std::vector<BN> exp_arr;
+        BN expected(1);
+        for(int i = 0; i < k; i++) {
+            BN base = safeheron::rand::RandomBNLtCoPrime(n);
+            BN exp = safeheron::rand::RandomBN(32 + 300 * i);
+            if(i % 2 == 1) exp = exp.Neg();
+            if(i == 3) exp = BN::ZERO;
+            base_arr.push_back(base);
+            exp_arr.push_back(exp);
+            expected = (expected * base.PowM(exp, n)) % n;
+        }
+        EXPECT_TRUE(mont_n.MultiPowM(base_arr, exp_arr) == expected);
+    }
+}
+
+TEST_F(TSS_RSA_3_5, Combiner_VerifySigShares) {
+    std::vector<std::string> doc_arr = {"12345678123456781234567812345678", "hello world"};
+
+    std::vector<std::vector<RSASigShare>> sig_arr_arr(doc_arr.size());
+    for(size_t d = 0; d < doc_arr.size(); d++) {
+        for(int i = 0; i < l; i++) {
+            sig_arr_arr[d].push_back(priv_arr[i].Sign(doc_arr[d], key_meta, pub));
+        }
+    }
+
+    Combiner combiner(pub, key_meta);
+    std::vector<size_t> invalid_arr;
+    EXPECT_TRUE(combiner.VerifySigShares(doc_arr[0], sig_arr_arr[0], invalid_arr));
+    EXPECT_TRUE(invalid_arr.empty());
+    std::vector<std::vector<size_t>> invalid_arr_arr;
+    EXPECT_TRUE(combiner.VerifySigSharesBatch(doc_arr, sig_arr_arr, invalid_arr_arr));
+
+    // A share of another document, and a share with a tampered proof.
+    sig_arr_arr[0][1] = sig_arr_arr[1][1];
+    sig_arr_arr[1][3].set_z(sig_arr_arr[1][3].z() + 1);
+    EXPECT_FALSE(combiner.VerifySigShares(doc_arr[0], sig_arr_arr[0], invalid_arr));
+    EXPECT_TRUE(invalid_arr == std::vector<size_t>({1}));
+    EXPECT_FALSE(combiner.VerifySigSharesBatch(doc_arr, sig_arr_arr, invalid_arr_arr));
+    EXPECT_TRUE(invalid_arr_arr[0] == std::vector<size_t>({1}));
+    EXPECT_TRUE(invalid_arr_arr[1] == std::vector<size_t>({3}));
+
+    BN sig;
+    EXPECT_FALSE(combiner.CombineSignatures(doc_arr[1], sig_arr_arr[1], sig));
+    std::vector<RSASigShare> valid_arr = {sig_arr_arr[1][0], sig_arr_arr[1][2], sig_arr_arr[1][4]};
+    EXPECT_TRUE(combiner.CombineSignatures(doc_arr[1], valid_arr, sig));
+    EXPECT_TRUE(pub.VerifySignature(doc_arr[1], sig));
+}
+
+TEST(TSS_RSA, MontContext_BatchPowM) {
+    BN n = safeheron::rand::RandomPrime(512) * safeheron::rand::RandomPrime(512);
+    MontContext mont_n(n);
+    BN base = safeheron::rand::RandomBNLt(n);
+    std::vector<BN> exp_arr = {BN(0), BN(1), safeheron::rand::RandomBN(1024), safeheron::rand::RandomBN(300)};
+    std::vector<BN> ret_arr = mont_n.BatchPowM(base, exp_arr);
+    for(size_t j = 0; j < exp_arr.size(); j++) {
+        EXPECT_TRUE(ret_arr[j] == base.PowM(exp_arr[j], n));
+    }
+
+    std::vector<BN> inv_arr;
+    EXPECT_TRUE(mont_n.BatchInvM(exp_arr, inv_arr) == false);
+    std::vector<BN> a_arr = {safeheron::rand::RandomBNLtCoPrime(n), safeheron::rand::RandomBNLtCoPrime(n), BN(1)};
+    EXPECT_TRUE(mont_n.BatchInvM(a_arr, inv_arr));
+    for(size_t j = 0; j < a_arr.size(); j++) {
+        EXPECT_TRUE(inv_arr[j] == a_arr[j].InvM(n));
+    }
+}
+
+TEST(TSS_RSA, KeyGenParallel2_3_Sign_2_3) {
+    std::string doc("12345678123456781234567812345678");
+
+    // Safe primes of exact bit length
+    BN p = safeheron::tss_rsa::GenerateSafePrime(512, 4);
+    EXPECT_EQ(p.BitLength(), 512);
+    EXPECT_TRUE(p.IsProbablyPrime());
+    EXPECT_TRUE(((p - 1) / 2).IsProbablyPrime());
+
+    // Key Generation with 4 threads
+    int key_bits_length = 1024;
+    int k = 2;
+    int l = 3;
+    std::vector<RSAPrivateKeyShare> priv_arr;
+    RSAPublicKey pub;
+    RSAKeyMeta key_meta;
+    bool status = safeheron::tss_rsa::GenerateKey(key_bits_length, l, k, 4, priv_arr, pub, key_meta);
+    EXPECT_TRUE(status);
+
+    std::vector<RSASigShare> sig_share_arr;
+    sig_share_arr.push_back(priv_arr[0].Sign(doc, key_meta, pub));
+    sig_share_arr.push_back(priv_arr[2].Sign(doc, key_meta, pub));
+    BN sig;
+    status = safeheron::tss_rsa::CombineSignatures(doc, sig_share_arr, pub, key_meta, sig);
+    EXPECT_TRUE(status);
+    EXPECT_TRUE(pub.VerifySignature(doc, sig));
+
+    // GenerateKeyEx with 4 threads, p and q are generated.
+    priv_arr.clear();
+    status = safeheron::tss_rsa::GenerateKeyEx(key_bits_length, l, k, KeyGenParam(), 4, priv_arr, pub, key_meta);
+    EXPECT_TRUE(status);
+    sig_share_arr.clear();
+    sig_share_arr.push_back(priv_arr[1].Sign(doc, key_meta, pub));
+    sig_share_arr.push_back(priv_arr[2].Sign(doc, key_meta, pub));
+    status = safeheron::tss_rsa::CombineSignatures(doc, sig_share_arr, pub, key_meta, sig);
+    EXPECT_TRUE(status);
+    EXPECT_TRUE(pub.VerifySignature(doc, sig));
+}
+
+TEST(TSS_RSA, GenerateSafePrime) {
+    // Small windows and a short prime table, so that the search moves through many windows.
+    safeheron::tss_rsa::SafePrimeSieveParam param = {64, 16};
+    safeheron::tss_rsa::SafePrimeSearchStat stat;
+    for(int thread_num = 1; thread_num <= 3; thread_num++) {
+        BN p = safeheron::tss_rsa::GenerateSafePrime(256, thread_num, param, stat);
+        EXPECT_EQ(p.BitLength(), 256);
+        EXPECT_TRUE(p.IsProbablyPrime());
+        EXPECT_TRUE(((p - 1) / 2).IsProbablyPrime());
+        EXPECT_TRUE(stat.tested_num > 0);
+        EXPECT_TRUE(stat.tested_num < stat.sieved_num);
+    }
+
+    BN p = safeheron::tss_rsa::GenerateSafePrime(1024, 1, safeheron::tss_rsa::DefaultSafePrimeSieveParam(1024), stat);
+    EXPECT_EQ(p.BitLength(), 1024);
+    EXPECT_TRUE(p.IsProbablyPrime());
+    EXPECT_TRUE(((p - 1) / 2).IsProbablyPrime());
+
+    param.interval = 0;
+    EXPECT_THROW(safeheron::tss_rsa::GenerateSafePrime(256, 1, param, stat), LocatedException);
+}
+
+TEST(TSS_RSA, SafePrimePool) {
+    std::string doc("12345678123456781234567812345678");
+    safeheron::tss_rsa::SafePrimePool pool({512, 511}, 2, 2);
+    safeheron::tss_rsa::SafePrimePoolStat stat;
+
+    // Wait until both queues are full.
+    pool.Start();
+    for(int t = 0; t < 600; t++) {
+        safeheron::tss_rsa::SafePrimePoolStat q_stat;
+        EXPECT_TRUE(pool.GetStat(512, stat));
+        EXPECT_TRUE(pool.GetStat(511, q_stat));
+        if(stat.size == 2 && q_stat.size == 2) break;
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+    pool.Stop();
+    EXPECT_TRUE(pool.GetStat(512, stat));
+    EXPECT_EQ(stat.size, 2);
+    EXPECT_EQ(stat.capacity, 2);
+    EXPECT_TRUE(stat.generated_num >= 2);
+    EXPECT_TRUE(stat.refill_rate > 0);
+    EXPECT_EQ(stat.error_num, 0);
+    EXPECT_TRUE(stat.last_error.empty());
+    EXPECT_FALSE(pool.GetStat(1024, stat));
+    EXPECT_THROW(safeheron::tss_rsa::SafePrimePool({512, 8}, 2, 1), LocatedException);
+
+    // Key Generation with safe primes of the pool
+    int key_bits_length = 1024;
+    int k = 2;
+    int l = 3;
+    std::vector<RSAPrivateKeyShare> priv_arr;
+    RSAPublicKey pub;
+    RSAKeyMeta key_meta;
+    bool status = safeheron::tss_rsa::GenerateKeyEx(key_bits_length, l, k, KeyGenParam(), pool, priv_arr, pub, key_meta);
+    EXPECT_TRUE(status);
+    EXPECT_TRUE(pool.GetStat(512, stat));
+    EXPECT_EQ(stat.size, 1);
+    EXPECT_EQ(stat.taken_num, 1);
+
+    std::vector<RSASigShare> sig_share_arr;
+    sig_share_arr.push_back(priv_arr[0].Sign(doc, key_meta, pub));
+    sig_share_arr.push_back(priv_arr[1].Sign(doc, key_meta, pub));
+    BN sig;
+    status = safeheron::tss_rsa::CombineSignatures(doc, sig_share_arr, pub, key_meta, sig);
+    EXPECT_TRUE(status);
+    EXPECT_TRUE(pub.VerifySignature(doc, sig));
+
+    // Save moves the safe primes into the file, load moves them back and deletes the file.
+    std::string path = "safe_prime_pool_test.bin";
+    std::string key(32, '\x5a');
+    BN p;
+    EXPECT_TRUE(pool.SaveToFile(path, key));
+    EXPECT_FALSE(pool.TryTake(512, p));
+    EXPECT_FALSE(pool.LoadFromFile(path, std::string(32, '\x00')));
+    EXPECT_TRUE(pool.LoadFromFile(path, key));
+    EXPECT_FALSE(pool.LoadFromFile(path, key));
+    EXPECT_TRUE(pool.TryTake(512, p));
+    EXPECT_EQ(p.BitLength(), 512);
+    EXPECT_TRUE(p.IsProbablyPrime());
+    EXPECT_TRUE(((p - 1) / 2).IsProbablyPrime());
+    EXPECT_FALSE(pool.TryTake(512, p));
+
+    // The safe primes which are not pooled or don't fit stay in the file.
+    EXPECT_TRUE(pool.SaveToFile(path, key));
+    safeheron::tss_rsa::SafePrimePool other_pool({512}, 1, 1);
+    EXPECT_TRUE(other_pool.LoadFromFile(path, key));
+    EXPECT_FALSE(other_pool.TryTake(512, p));
+    safeheron::tss_rsa::SafePrimePool full_pool({511}, 0, 1);
+    EXPECT_TRUE(full_pool.LoadFromFile(path, key));
+    EXPECT_FALSE(full_pool.TryTake(511, p));
+    EXPECT_TRUE(pool.LoadFromFile(path, key));
+    EXPECT_FALSE(pool.LoadFromFile(path, key));
+    EXPECT_TRUE(pool.TryTake(511, p));
+    EXPECT_EQ(p.BitLength(), 511);
+}
+
+TEST_F(TSS_RSA_2_3, SignBatch) {
+    std::vector<std::string> doc_arr;
+    for(int j = 0; j < 8; j++) {
+        doc_arr.push_back("1234567812345678123456781234567" + std::to_string(j));
+    }
+
+    // Sign all the messages at once, in the calling thread for party 1 and on 4 threads for party 3.
+    std::vector<RSASigShare> sig_share_arr1 = priv_arr[0].SignBatch(doc_arr, key_meta, pub, 1);
+    std::vector<RSASigShare> sig_share_arr3 = SigningContext(priv_arr[2], key_meta, pub).SignBatch(doc_arr, 4);
+    EXPECT_EQ(sig_share_arr1.size(), doc_arr.size());
+    EXPECT_EQ(sig_share_arr3.size(), doc_arr.size());
+
+    for(size_t j = 0; j < doc_arr.size(); j++) {
+        // The signature share is the same as the one of "RSAPrivateKeyShare::Sign".
+        EXPECT_TRUE(sig_share_arr1[j].sig_share() == priv_arr[0].Sign(doc_arr[j], key_meta, pub).sig_share());
+
+        std::vector<RSASigShare> sig_share_arr = {sig_share_arr1[j], sig_share_arr3[j]};
+        BN sig;
+        bool status = safeheron::tss_rsa::CombineSignatures(doc_arr[j], sig_share_arr, pub, key_meta, sig);
+        EXPECT_TRUE(status);
+
+        // Verify the final signature.
+        EXPECT_TRUE(pub.VerifySignature(doc_arr[j], sig));
+    }
+
+    EXPECT_TRUE(priv_arr[1].SignBatch(std::vector<std::string>(), key_meta, pub, 4).empty());
+}
+
+TEST_F(TSS_RSA_2_3, Combiner_CombineSignaturesBatch) {
+    std::vector<std::string> doc_arr;
+    for(int d = 0; d < 6; d++) {
+        doc_arr.push_back("hello world, " + std::to_string(d));
+    }
+
+    std::vector<std::vector<RSASigShare>> sig_arr_arr(doc_arr.size());
+    for(size_t d = 0; d < doc_arr.size(); d++) {
+        sig_arr_arr[d].push_back(priv_arr[d % l].Sign(doc_arr[d], key_meta, pub));
+        sig_arr_arr[d].push_back(priv_arr[(d + 1) % l].Sign(doc_arr[d], key_meta, pub));
+    }
+
+    Combiner combiner(pub, key_meta);
+    std::vector<BN> sig_arr;
+    std::vector<size_t> failed_arr;
+    EXPECT_TRUE(combiner.CombineSignaturesBatch(doc_arr, sig_arr_arr, 1, sig_arr, failed_arr));
+    EXPECT_TRUE(failed_arr.empty());
+    for(size_t d = 0; d < doc_arr.size(); d++) {
+        EXPECT_TRUE(pub.VerifySignature(doc_arr[d], sig_arr[d]));
+    }
+
+    // A share with a tampered proof, and a signer set with a duplicated party.
+    sig_arr_arr[1][0].set_z(sig_arr_arr[1][0].z() + 1);
+    sig_arr_arr[4][1] = sig_arr_arr[4][0];
+    EXPECT_FALSE(safeheron::tss_rsa::CombineSignaturesBatch(doc_arr, sig_arr_arr, pub, key_meta, 4, sig_arr, failed_arr));
+    EXPECT_TRUE(failed_arr == std::vector<size_t>({1, 4}));
+    for(size_t d = 0; d < doc_arr.size(); d++) {
+        if(d == 1 || d == 4) {
+            EXPECT_TRUE(sig_arr[d] == 0);
+        } else {
+            EXPECT_TRUE(pub.VerifySignature(doc_arr[d], sig_arr[d]));
+        }
+    }
+}
+
+TEST(TSS_RSA, MontContext_PowMWord) {
+    BN n = safeheron::rand::RandomPrime(512) * safeheron::rand::RandomPrime(512);
+    MontContext mont_n(n);
+    BN base = safeheron::rand::RandomBNLt(n);
+    uint64_t exp_arr[] = {0, 1, 2, 3, 65537, 0xFFFFFFFFFFFFFFFFull};
+    for(uint64_t exp : exp_arr) {
+        char buf[17];
+        snprintf(buf, sizeof(buf), "%016llx", (unsigned long long)exp);
+        EXPECT_TRUE(mont_n.PowMWord(base, exp) == base.PowM(BN::FromHexStr(buf), n));
+    }
+}
+
+TEST_F(TSS_RSA_2_3, RSAPublicKey_VerifySignatureBatch) {
+    std::vector<std::string> doc_arr;
+    for(int d = 0; d < 5; d++) {
+        doc_arr.push_back("hello world, " + std::to_string(d));
+    }
+
+    std::vector<std::vector<RSASigShare>> sig_arr_arr;
+    for(const auto &doc : doc_arr) {
+        sig_arr_arr.push_back({priv_arr[0].Sign(doc, key_meta, pub), priv_arr[1].Sign(doc, key_meta, pub)});
+    }
+    std::vector<BN> sig_arr;
+    std::vector<size_t> failed_arr;
+    EXPECT_TRUE(Combiner(pub, key_meta).CombineSignaturesBatch(doc_arr, sig_arr_arr, 1, sig_arr, failed_arr));
+
+    std::vector<size_t> invalid_arr;
+    EXPECT_TRUE(pub.VerifySignatureBatch(doc_arr, sig_arr, invalid_arr));
+    EXPECT_TRUE(invalid_arr.empty());
+
+    // The key from its serialized form verifies the same way.
+    std::string base64;
+    RSAPublicKey pub2;
+    EXPECT_TRUE(pub.ToBase64(base64));
+    EXPECT_TRUE(pub2.FromBase64(base64));
+    EXPECT_TRUE(pub2.VerifySignatureBatch(doc_arr, sig_arr, invalid_arr));
+
+    sig_arr[3] = sig_arr[3] + 1;
+    EXPECT_FALSE(pub.VerifySignature(doc_arr[3], sig_arr[3]));
+    EXPECT_FALSE(pub.VerifySignatureBatch(doc_arr, sig_arr, invalid_arr));
+    EXPECT_TRUE(invalid_arr == std::vector<size_t>({3}));
+
+    // A signature which is a valid one times -1 is rejected.
+    sig_arr[3] = pub.n() - (sig_arr[3] - 1);
+    EXPECT_FALSE(pub.VerifySignatureBatch(doc_arr, sig_arr, invalid_arr));
+    EXPECT_TRUE(invalid_arr == std::vector<size_t>({3}));
+}
+
+TEST(TSS_RSA, FixedBaseTable) {
+    BN n = safeheron::rand::RandomPrime(512) * safeheron::rand::RandomPrime(512);
+    MontContext mont_n(n);
+    BN base = safeheron::rand::RandomBNLtCoPrime(n);
+    for(int h = 1; h <= 8; h += 3) {
+        FixedBaseTable table(mont_n, base, 1300, h);
+        EXPECT_GE(table.max_exp_bits(), 1300);
+        EXPECT_EQ(table.MemorySize(), FixedBaseTable::MemorySize(1024, h));
+        std::vector<BN> exp_arr = {BN::ZERO, BN::ONE, safeheron::rand::RandomBN(100), safeheron::rand::RandomBN(1300)};
+        for(const auto &exp : exp_arr) {
+            BN expected = base.PowM(exp, n);
+            EXPECT_TRUE(table.PowM(exp) == expected);
+        }
+        // Longer exponents fall back to "MontContext::PowM".
+        BN exp = safeheron::rand::RandomBN(2000);
+        EXPECT_TRUE(table.PowM(exp) == base.PowM(exp, n));
+    }
+}
+
+TEST_F(TSS_RSA_2_3, RSAKeyMeta_FixedBaseTables) {
+    std::string doc("12345678123456781234567812345678");
+
+    RSAKeyMeta table_key_meta = key_meta;
+    EXPECT_TRUE(table_key_meta.vkv_table() == nullptr);
+    EXPECT_EQ(table_key_meta.FixedBaseTableMemorySize(), 0);
+    EXPECT_TRUE(table_key_meta.BuildFixedBaseTables(pub.n(), 5));
+    EXPECT_EQ(table_key_meta.FixedBaseTableMemorySize(), RSAKeyMeta::FixedBaseTableMemorySize(1024, l, 5));
+
+    // The shares are verified with and without the tables.
+    std::vector<RSASigShare> sig_share_arr;
+    sig_share_arr.push_back(priv_arr[0].Sign(doc, table_key_meta, pub));
+    sig_share_arr.push_back(SigningContext(priv_arr[2], key_meta, pub).SignLowLatency(doc));
+    sig_share_arr.push_back(SigningContext(priv_arr[1], table_key_meta, pub).SignLowLatency(doc));
+    std::vector<size_t> invalid_arr;
+    EXPECT_TRUE(Combiner(pub, table_key_meta).VerifySigShares(doc, sig_share_arr, invalid_arr));
+    EXPECT_TRUE(Combiner(pub, key_meta).VerifySigShares(doc, sig_share_arr, invalid_arr));
+
+    BN x = BN::FromBytesBE(doc);
+    if(BN::JacobiSymbol(x, pub.n()) == -1) x = (x * key_meta.vku().PowM(pub.e(), pub.n())) % pub.n();
+    RSASigShareProof proof;
+    proof.Prove(priv_arr[0].si(), key_meta.vkv(), key_meta.vki(0), x, MontContext(pub.n()), sig_share_arr[0].sig_share());
+    EXPECT_TRUE(proof.Verify(*table_key_meta.vkv_table(), *table_key_meta.vki_inv_table(0), key_meta.vki(0), x, sig_share_arr[0].sig_share()));
+    EXPECT_TRUE(proof.Verify(key_meta.vkv(), key_meta.vki(0), x, pub.n(), sig_share_arr[0].sig_share()));
+    EXPECT_FALSE(proof.Verify(*table_key_meta.vkv_table(), *table_key_meta.vki_inv_table(1), key_meta.vki(1), x, sig_share_arr[0].sig_share()));
+
+    // A tampered proof is caught with the tables.
+    sig_share_arr[2].set_z(sig_share_arr[2].z() + 1);
+    EXPECT_FALSE(Combiner(pub, table_key_meta).VerifySigShares(doc, sig_share_arr, invalid_arr));
+    EXPECT_TRUE(invalid_arr == std::vector<size_t>({2}));
+
+    // The tables are dropped when the validation keys change.
+    table_key_meta.set_vkv(key_meta.vkv());
+    EXPECT_TRUE(table_key_meta.vkv_table() == nullptr);
+    EXPECT_TRUE(table_key_meta.vki_inv_table(0) == nullptr);
+}
+
+TEST_F(TSS_RSA_2_3, ProofCommitmentPool) {
+    std::string doc("12345678123456781234567812345678");
+
+    // Wait until the pool is full.
+    safeheron::tss_rsa::ProofCommitmentPool pool(key_meta, pub, 3, 2);
+    safeheron::tss_rsa::ProofCommitmentPoolStat stat;
+    pool.Start();
+    for(int t = 0; t < 600; t++) {
+        pool.GetStat(stat);
+        if(stat.size == 3) break;
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    EXPECT_EQ(stat.size, 3);
+    EXPECT_EQ(stat.capacity, 3);
+    EXPECT_TRUE(stat.generated_num >= 3);
+    EXPECT_TRUE(stat.refill_rate > 0);
+    EXPECT_EQ(stat.error_num, 0);
+    EXPECT_TRUE(stat.last_error.empty());
+
+    // A pair is taken once only, and v' = v^r.
+    BN r, vp;
+    EXPECT_TRUE(pool.TryTake(r, vp));
+    EXPECT_TRUE(vp == key_meta.vkv().PowM(r, pub.n()));
+
+    // Sign with two pairs of the pool, then with a miss once the pool is stopped and wiped.
+    SigningContext ctx0(priv_arr[0], key_meta, pub);
+    SigningContext ctx2(priv_arr[2], key_meta, pub);
+    std::vector<RSASigShare> sig_share_arr;
+    sig_share_arr.push_back(ctx0.Sign(doc, pool));
+    sig_share_arr.push_back(ctx2.Sign(doc, pool));
+    pool.Stop();
+    pool.GetStat(stat);
+    EXPECT_EQ(stat.size, 0);
+    EXPECT_FALSE(pool.TryTake(r, vp));
+    RSASigShare sig_share = ctx0.Sign(doc, pool);
+    EXPECT_TRUE(sig_share.sig_share() == sig_share_arr[0].sig_share());
+    EXPECT_FALSE(sig_share.z() == sig_share_arr[0].z());
+    pool.GetStat(stat);
+    EXPECT_EQ(stat.size, 0);
+    EXPECT_EQ(stat.taken_num, 3);
+    EXPECT_EQ(stat.miss_num, 2);
+    EXPECT_EQ(stat.online_num, 3);
+    EXPECT_TRUE(stat.online_mean_us > 0);
+    EXPECT_TRUE(stat.online_max_us >= stat.online_mean_us);
+
+    std::vector<size_t> invalid_arr;
+    Combiner combiner(pub, key_meta);
+    EXPECT_TRUE(combiner.VerifySigShares(doc, {sig_share_arr[0], sig_share_arr[1], sig_share}, invalid_arr));
+    BN sig;
+    bool status = safeheron::tss_rsa::CombineSignatures(doc, sig_share_arr, pub, key_meta, sig);
+    EXPECT_TRUE(status);
+    EXPECT_TRUE(pub.VerifySignature(doc, sig));
+
+    // A pool of another validation key is refused.
+    RSAKeyMeta other_key_meta = key_meta;
+    other_key_meta.set_vkv(key_meta.vkv() * key_meta.vkv() % pub.n());
+    safeheron::tss_rsa::ProofCommitmentPool other_pool(other_key_meta, pub, 1, 1);
+    EXPECT_THROW(ctx0.Sign(doc, other_pool), LocatedException);
+}
+
+TEST_F(TSS_RSA_2_3, ToBytes_FromBytes) {
+    std::string doc("12345678123456781234567812345678");
+    RSASigShare sig_share = priv_arr[0].Sign(doc, key_meta, pub);
+
+    // Round trip of each class.
+    std::string bytes, b64;
+    RSAPublicKey pub2;
+    EXPECT_TRUE(pub.ToBytes(bytes));
+    EXPECT_TRUE(pub2.FromBytes(bytes));
+    EXPECT_TRUE(pub2.n() == pub.n() && pub2.e() == pub.e());
+
+    RSAPrivateKeyShare priv2(0, BN::ZERO);
+    EXPECT_TRUE(priv_arr[1].ToBytes(bytes));
+    EXPECT_TRUE(priv2.FromBytes(bytes));
+    EXPECT_TRUE(priv2.i() == priv_arr[1].i() && priv2.si() == priv_arr[1].si());
+
+    RSAKeyMeta key_meta2;
+    EXPECT_TRUE(key_meta.ToBytes(bytes));
+    EXPECT_TRUE(key_meta2.FromBytes(bytes));
+    EXPECT_TRUE(key_meta2.k() == key_meta.k() && key_meta2.l() == key_meta.l());
+    EXPECT_TRUE(key_meta2.vkv() == key_meta.vkv() && key_meta2.vku() == key_meta.vku());
+    EXPECT_EQ(key_meta2.vki_arr().size(), key_meta.vki_arr().size());
+    for(size_t i = 0; i < key_meta.vki_arr().size(); i++) {
+        EXPECT_TRUE(key_meta2.vki(i) == key_meta.vki(i));
+    }
+
+    RSASigShareProof proof(sig_share.z(), sig_share.c()), proof2;
+    EXPECT_TRUE(proof.ToBytes(bytes));
+    EXPECT_TRUE(proof2.FromBytes(bytes));
+    EXPECT_TRUE(proof2.z() == proof.z() && proof2.c() == proof.c());
+
+    // A signature share takes less than half of the size of the base64 format.
+    RSASigShare sig_share2;
+    EXPECT_TRUE(sig_share.ToBytes(bytes));
+    EXPECT_TRUE(sig_share.ToBase64(b64));
+    EXPECT_TRUE(bytes.size() * 2 < b64.size());
+    EXPECT_TRUE(sig_share2.FromBytes(bytes));
+    EXPECT_EQ(sig_share2.index(), sig_share.index());
+    EXPECT_TRUE(sig_share2.sig_share() == sig_share.sig_share());
+    EXPECT_TRUE(sig_share2.z() == sig_share.z() && sig_share2.c() == sig_share.c());
+    std::vector<RSASigShare> sig_share_arr = {sig_share2, priv_arr[2].Sign(doc, key_meta, pub)};
+    BN sig;
+    EXPECT_TRUE(safeheron::tss_rsa::CombineSignatures(doc, sig_share_arr, pub2, key_meta2, sig));
+    EXPECT_TRUE(pub.VerifySignature(doc, sig));
+
+    // The base64 format is still readable.
+    EXPECT_TRUE(sig_share2.FromBase64(b64));
+    EXPECT_TRUE(sig_share2.sig_share() == sig_share.sig_share());
+
+    // Truncated, extended, and mistyped data is refused.
+    EXPECT_FALSE(sig_share2.FromBytes(bytes.substr(0, bytes.size() - 1)));
+    EXPECT_FALSE(sig_share2.FromBytes(bytes + "x"));
+    EXPECT_FALSE(sig_share2.FromBytes(""));
+    EXPECT_FALSE(pub2.FromBytes(bytes));
+    std::string bad = bytes;
+    bad[0] = 0x01;
+    EXPECT_FALSE(sig_share2.FromBytes(bad));
+    EXPECT_FALSE(RSASigShare().ToBytes(bytes));
+}
+
+TEST_F(TSS_RSA_3_5, KeyMetaView) {
+    std::string doc("12345678123456781234567812345678");
+
+    std::string bytes;
+    EXPECT_TRUE(key_meta.ToBytes(bytes));
+    safeheron::tss_rsa::RSAKeyMetaView view;
+    EXPECT_TRUE(view.Load(bytes));
+    EXPECT_EQ(view.k(), k);
+    EXPECT_EQ(view.l(), l);
+    EXPECT_EQ(view.vki_num(), (size_t)l);
+    EXPECT_TRUE(view.vkv() == key_meta.vkv() && view.vku() == key_meta.vku());
+    EXPECT_EQ(view.CachedNum(), (size_t)0);
+
+    // Only the validation keys of the signers are decoded.
+    std::vector<RSASigShare> sig_arr;
+    for(int i : {0, 2, 4}){
+        sig_arr.push_back(priv_arr[i].Sign(doc, key_meta, pub));
+    }
+    BN sig;
+    EXPECT_TRUE(safeheron::tss_rsa::CombineSignatures(doc, sig_arr, pub, view, sig));
+    EXPECT_TRUE(pub.VerifySignature(doc, sig));
+    EXPECT_EQ(view.CachedNum(), (size_t)3);
+    EXPECT_TRUE(view.vki(2) == key_meta.vki(2));
+
+    // A share of another party still needs a valid proof.
+    std::vector<RSASigShare> bad_sig_arr = sig_arr;
+    bad_sig_arr[1] = RSASigShare(2, sig_arr[1].sig_share(), sig_arr[1].z(), sig_arr[1].c());
+    EXPECT_FALSE(safeheron::tss_rsa::CombineSignatures(doc, bad_sig_arr, pub, view, sig));
+    bad_sig_arr[1] = RSASigShare(6, sig_arr[1].sig_share(), sig_arr[1].z(), sig_arr[1].c());
+    EXPECT_FALSE(safeheron::tss_rsa::CombineSignatures(doc, bad_sig_arr, pub, view, sig));
+    EXPECT_THROW(view.vki(l), safeheron::exception::LocatedException);
+
+    RSAKeyMeta key_meta2;
+    EXPECT_TRUE(view.ToKeyMeta(key_meta2));
+    for(int i = 0; i < l; i++){
+        EXPECT_TRUE(key_meta2.vki(i) == key_meta.vki(i));
+    }
+
+    // A bad buffer leaves the view as it was.
+    EXPECT_FALSE(view.Load((const uint8_t *)bytes.data(), bytes.size() - 1));
+    EXPECT_EQ(view.vki_num(), (size_t)l);
+    EXPECT_FALSE(safeheron::tss_rsa::RSAKeyMetaView().ToKeyMeta(key_meta2));
+
+    // The view may be loaded again while another thread reads it.
+    std::thread reader([&]() {
+        for(int t = 0; t < 200; t++) {
+            EXPECT_TRUE(view.vki(t % l) == key_meta.vki(t % l));
+        }
+    });
+    for(int t = 0; t < 200; t++) {
+        EXPECT_TRUE(view.Load(bytes));
+    }
+    reader.join();
+}
+
+TEST_F(TSS_RSA_3_5, Combiner_Optimistic) {
+    std::string doc("12345678123456781234567812345678");
+
+    std::vector<RSASigShare> sig_share_arr;
+    for(int i = 0; i < 4; i++) {
+        sig_share_arr.push_back(priv_arr[i].Sign(doc, key_meta, pub));
+    }
+
+    Combiner combiner(pub, key_meta);
+    BN sig, expected_sig;
+    std::vector<size_t> invalid_arr;
+    EXPECT_TRUE(combiner.CombineSignaturesOptimistic(doc, sig_share_arr, sig, invalid_arr));
+    EXPECT_TRUE(invalid_arr.empty());
+    EXPECT_TRUE(pub.VerifySignature(doc, sig));
+    EXPECT_TRUE(safeheron::tss_rsa::CombineSignaturesOptimistic(doc, sig_share_arr, pub, key_meta, expected_sig, invalid_arr));
+    EXPECT_TRUE(sig == expected_sig);
+
+    // A bad share is found and replaced by the spare one.
+    std::vector<RSASigShare> bad_arr = sig_share_arr;
+    bad_arr[1] = RSASigShare(bad_arr[1].index(), bad_arr[1].sig_share() * 2 % pub.n(), bad_arr[1].z(), bad_arr[1].c());
+    EXPECT_TRUE(combiner.CombineSignaturesOptimistic(doc, bad_arr, sig, invalid_arr));
+    EXPECT_EQ(invalid_arr, std::vector<size_t>({1}));
+    EXPECT_TRUE(pub.VerifySignature(doc, sig));
+
+    // A share of a party which signed twice is spare too.
+    std::vector<RSASigShare> duplicated_arr = {bad_arr[1], sig_share_arr[0], sig_share_arr[1], sig_share_arr[2]};
+    EXPECT_TRUE(combiner.CombineSignaturesOptimistic(doc, duplicated_arr, sig, invalid_arr));
+    EXPECT_EQ(invalid_arr, std::vector<size_t>({0}));
+    EXPECT_TRUE(pub.VerifySignature(doc, sig));
+
+    // Not enough valid shares.
+    bad_arr[2] = RSASigShare(bad_arr[2].index(), bad_arr[2].sig_share() * 2 % pub.n(), bad_arr[2].z(), bad_arr[2].c());
+    EXPECT_FALSE(combiner.CombineSignaturesOptimistic(doc, bad_arr, sig, invalid_arr));
+    EXPECT_EQ(invalid_arr, std::vector<size_t>({1, 2}));
+    sig_share_arr.resize(2);
+    EXPECT_FALSE(combiner.CombineSignaturesOptimistic(doc, sig_share_arr, sig, invalid_arr));
+}
+
+TEST_F(TSS_RSA_3_5, Combiner_MinimalCost) {
+    std::string doc("12345678123456781234567812345678");
+
+    // The shares arrive out of order.
+    std::vector<RSASigShare> sig_share_arr;
+    for(int i : {4, 0, 3, 1, 2}) {
+        sig_share_arr.push_back(priv_arr[i].Sign(doc, key_meta, pub));
+    }
+
+    Combiner combiner(pub, key_meta);
+    BN sig;
+    std::vector<size_t> used_arr;
+    EXPECT_TRUE(combiner.CombineSignaturesWithMinimalCost(doc, sig_share_arr, sig, used_arr));
+    EXPECT_TRUE(pub.VerifySignature(doc, sig));
+    EXPECT_EQ(used_arr.size(), (size_t)k);
+
+    // No other signer set is cheaper.
+    std::vector<int> used_index_arr;
+    for(size_t pos : used_arr) used_index_arr.push_back(sig_share_arr[pos].index());
+    std::sort(used_index_arr.begin(), used_index_arr.end());
+    size_t used_cost = 0, cost = 0;
+    EXPECT_TRUE(combiner.GetSubsetCost(used_index_arr, used_cost));
+    for(int a = 1; a <= l; a++) {
+        for(int b = a + 1; b <= l; b++) {
+            for(int c = b + 1; c <= l; c++) {
+                EXPECT_TRUE(combiner.GetSubsetCost({a, b, c}, cost));
+                EXPECT_LE(used_cost, cost);
+            }
+        }
+    }
+    EXPECT_FALSE(combiner.GetSubsetCost({2, 1, 3}, cost));
+    // A copy keeps the memoized costs.
+    Combiner combiner_copy(combiner);
+    EXPECT_TRUE(combiner_copy.GetSubsetCost(used_index_arr, cost));
+    EXPECT_EQ(cost, used_cost);
+
+    // A bad share in the picked set is excluded.
+    std::vector<RSASigShare> bad_arr = sig_share_arr;
+    size_t bad_pos = used_arr[0];
+    bad_arr[bad_pos] = RSASigShare(bad_arr[bad_pos].index(), bad_arr[bad_pos].sig_share() * 2 % pub.n(), bad_arr[bad_pos].z(), bad_arr[bad_pos].c());
+    EXPECT_TRUE(combiner.CombineSignaturesWithMinimalCost(doc, bad_arr, sig, used_arr));
+    EXPECT_TRUE(pub.VerifySignature(doc, sig));
+    EXPECT_TRUE(std::find(used_arr.begin(), used_arr.end(), bad_pos) == used_arr.end());
+
+    // Not enough shares.
+    bad_arr.resize(2);
+    EXPECT_FALSE(combiner.CombineSignaturesWithMinimalCost(doc, bad_arr, sig, used_arr));
+}
+
+TEST_F(TSS_RSA_3_5, CombineSession) {
+    std::string doc("12345678123456781234567812345678");
+
+    std::vector<RSASigShare> sig_share_arr;
+    for(int i = 0; i < l; i++) {
+        sig_share_arr.push_back(priv_arr[i].Sign(doc, key_meta, pub));
+    }
+    RSASigShare bad_share(2, sig_share_arr[1].sig_share() * 2 % pub.n(), sig_share_arr[1].z(), sig_share_arr[1].c());
+
+    Combiner combiner(pub, key_meta);
+    BN expected_sig, sig;
+    EXPECT_TRUE(combiner.CombineSignatures(doc, {sig_share_arr[0], sig_share_arr[1], sig_share_arr[2]}, expected_sig));
+
+    // The expected signer set responds.
+    {
+        safeheron::tss_rsa::CombineSession session(combiner, doc, {3, 1, 2});
+        EXPECT_TRUE(session.AddShare(sig_share_arr[2]));
+        EXPECT_FALSE(session.AddShare(sig_share_arr[2]));
+        EXPECT_FALSE(session.AddShare(bad_share));
+        EXPECT_TRUE(session.AddShare(sig_share_arr[0]));
+        EXPECT_FALSE(session.IsComplete());
+        EXPECT_FALSE(session.GetSignature(sig));
+        EXPECT_TRUE(session.AddShare(sig_share_arr[1]));
+        EXPECT_TRUE(session.IsComplete());
+        EXPECT_TRUE(session.GetSignature(sig));
+        EXPECT_TRUE(sig == expected_sig);
+        EXPECT_EQ(session.GetValidIndexes(), std::vector<int>({3, 1, 2}));
+        EXPECT_FALSE(session.AddShare(sig_share_arr[3]));
+    }
+
+    // Party 2 of the expected set fails, and party 5 replaces it.
+    {
+        safeheron::tss_rsa::CombineSession session(combiner, doc, {1, 2, 3});
+        EXPECT_TRUE(session.AddShare(sig_share_arr[0]));
+        EXPECT_FALSE(session.AddShare(bad_share));
+        EXPECT_TRUE(session.AddShare(sig_share_arr[4]));
+        EXPECT_TRUE(session.AddShare(sig_share_arr[2]));
+        EXPECT_TRUE(session.GetSignature(sig));
+        EXPECT_TRUE(pub.VerifySignature(doc, sig));
+    }
+
+    // Without an expected signer set.
+    {
+        safeheron::tss_rsa::CombineSession session(combiner, doc);
+        for(int i = l - 1; i >= 0; i--) {
+            EXPECT_EQ(session.AddShare(sig_share_arr[i]), i >= l - k);
+        }
+        EXPECT_TRUE(session.GetSignature(sig));
+        EXPECT_TRUE(pub.VerifySignature(doc, sig));
+    }
+
+    EXPECT_THROW(safeheron::tss_rsa::CombineSession(combiner, doc, {1, 2}), LocatedException);
+    EXPECT_THROW(safeheron::tss_rsa::CombineSession(combiner, doc, {1, 2, 2}), LocatedException);
+}
+
 
 int main(int argc, char **argv) {
     ::testing::InitGoogleTest(&argc, argv);
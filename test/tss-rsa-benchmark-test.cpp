@@ -1,7 +1,12 @@
+#include <chrono>
+#include <map>
+#include <thread>
 #include <benchmark/benchmark.h>
 #include "gtest/gtest.h"
 #include "crypto-bn/bn.h"
+#include "crypto-bn/rand.h"
 #include "../src/crypto-tss-rsa/tss_rsa.h"
+#include "../src/crypto-tss-rsa/common.h"
 #include "exception/safeheron_exceptions.h"
 using safeheron::bignum::BN;
 using safeheron::tss_rsa::RSAPrivateKeyShare;
@@ -9,14 +14,44 @@ using safeheron::tss_rsa::RSAPublicKey;
 using safeheron::tss_rsa::RSAKeyMeta;
 using safeheron::tss_rsa::RSASigShare;
 using safeheron::tss_rsa::KeyGenParam;
+using safeheron::tss_rsa::SigningContext;
+using safeheron::tss_rsa::Combiner;
+using safeheron::tss_rsa::MontContext;
 
 
 void BM_generateRandom(benchmark::State& state, int key_bits_length, int l, int k);
 void BM_generateEx(benchmark::State& state, int key_bits_length, int l, int k);
+void BM_generateParallel(benchmark::State& state, int key_bits_length, int l, int k);
+void BM_randomSafePrime(benchmark::State& state);
+void BM_generateSafePrime(benchmark::State& state);
 
 void BM_generateSig(benchmark::State& state);
+void BM_generateSigWithContext(benchmark::State& state);
+void BM_generateSigBatch(benchmark::State& state);
+void BM_signBits(benchmark::State& state);
+void BM_signLowLatencyBits(benchmark::State& state);
+void BM_signWithPoolBits(benchmark::State& state);
+void BM_verifySigShareBits(benchmark::State& state);
 void BM_combineSig(benchmark::State& state);
+void BM_combineSigWithCombiner(benchmark::State& state);
+void BM_combineSigBatch(benchmark::State& state);
+void BM_combineSigOptimistic(benchmark::State& state);
+void BM_combineSigMinimalCost(benchmark::State& state);
+void BM_combineSession(benchmark::State& state);
 void BM_verifySig(benchmark::State& state);
+void BM_verifySigBatch(benchmark::State& state);
+void BM_verifySigSharesOneByOne(benchmark::State& state);
+void BM_verifySigShares(benchmark::State& state);
+
+void BM_combineLoop(benchmark::State& state);
+void BM_combineMultiPowM(benchmark::State& state);
+
+void BM_encodePSS(benchmark::State& state);
+void BM_encodePSSIntoBuffer(benchmark::State& state);
+void BM_encodePSSWithHash(benchmark::State& state);
+
+void BM_serializeSigShare(benchmark::State& state);
+void BM_loadKeyMeta(benchmark::State& state);
 
 std::vector< std::vector<RSAPrivateKeyShare>> priv_arr;
 std::vector<RSAPublicKey> pub;
@@ -65,6 +100,41 @@ void BM_generateEx(benchmark::State& state, int key_bits_length, int l, int k) {
     }
 }
 
+void BM_generateParallel(benchmark::State& state, int key_bits_length, int l, int k) {
+    int thread_num = (int)state.range(0);
+    for (auto _ : state) {
+        std::vector<RSAPrivateKeyShare> t_priv_arr;
+        RSAPublicKey t_pub;
+        RSAKeyMeta t_key_meta;
+        safeheron::tss_rsa::GenerateKey(key_bits_length, l, k, thread_num, t_priv_arr, t_pub, t_key_meta);
+    }
+}
+
+void BM_randomSafePrime(benchmark::State& state) {
+    size_t bits = (size_t)state.range(0);
+    for (auto _ : state) {
+        BN p = safeheron::rand::RandomSafePrime(bits);
+        benchmark::DoNotOptimize(p);
+    }
+}
+
+void BM_generateSafePrime(benchmark::State& state) {
+    size_t bits = (size_t)state.range(0);
+    safeheron::tss_rsa::SafePrimeSieveParam param = safeheron::tss_rsa::DefaultSafePrimeSieveParam(bits);
+    uint64_t sieved_num = 0;
+    uint64_t tested_num = 0;
+    for (auto _ : state) {
+        safeheron::tss_rsa::SafePrimeSearchStat stat;
+        BN p = safeheron::tss_rsa::GenerateSafePrime(bits, 1, param, stat);
+        benchmark::DoNotOptimize(p);
+        sieved_num += stat.sieved_num;
+        tested_num += stat.tested_num;
+    }
+    // candidates per safe prime
+    state.counters["sieved"] = benchmark::Counter((double)sieved_num, benchmark::Counter::kAvgIterations);
+    state.counters["tested"] = benchmark::Counter((double)tested_num, benchmark::Counter::kAvgIterations);
+}
+
 void BM_generateSig(benchmark::State& state) {
     for (auto _: state) {
         for (size_t i = 0; i < priv_arr.size(); i++) {
@@ -76,6 +146,111 @@ void BM_generateSig(benchmark::State& state) {
     }
 }
 
+void BM_generateSigWithContext(benchmark::State& state) {
+    // The signing contexts are built once per key, outside of the timed loop.
+    std::vector< std::vector<SigningContext>> ctx_arr(priv_arr.size());
+    for (size_t i = 0; i < priv_arr.size(); i++) {
+        for (size_t j = 0; j < priv_arr[i].size(); j++) {
+            ctx_arr[i].emplace_back(priv_arr[i][j], key_meta[i], pub[i]);
+        }
+    }
+    for (auto _: state) {
+        for (size_t i = 0; i < ctx_arr.size(); i++) {
+            sig_arr[i].clear();
+            for (size_t j = 0; j < ctx_arr[i].size(); j++) {
+                sig_arr[i].emplace_back(ctx_arr[i][j].Sign(doc[i]));
+            }
+        }
+    }
+}
+
+void BM_generateSigBatch(benchmark::State& state) {
+    // Each party signs all the documents in one call, on state.range(0) threads.
+    std::vector<std::string> doc_arr(std::begin(doc), std::end(doc));
+    for (auto _: state) {
+        for (size_t i = 0; i < priv_arr.size(); i++) {
+            for (size_t j = 0; j < priv_arr[i].size(); j++) {
+                priv_arr[i][j].SignBatch(doc_arr, key_meta[i], pub[i], (int)state.range(0));
+            }
+        }
+    }
+}
+
+/**
+ * A 2/3 key of "bits" bits.
+ */
+struct BitsKey {
+    std::vector<RSAPrivateKeyShare> priv_arr;
+    RSAPublicKey pub;
+    RSAKeyMeta key_meta;
+};
+
+/**
+ * Get a 2/3 key of "bits" bits, generated on the first use.
+ */
+const BitsKey &KeyOfBits(int bits) {
+    static std::map<int, BitsKey> key_map;
+    auto iter = key_map.find(bits);
+    if (iter == key_map.end()) {
+        BitsKey key;
+        safeheron::tss_rsa::GenerateKey(bits, 3, 2, 8, key.priv_arr, key.pub, key.key_meta);
+        iter = key_map.emplace(bits, key).first;
+    }
+    return iter->second;
+}
+
+void BM_signBits(benchmark::State& state) {
+    const BitsKey &key = KeyOfBits((int)state.range(0));
+    SigningContext ctx(key.priv_arr[0], key.key_meta, key.pub);
+    for (auto _: state) {
+        ctx.Sign(doc[0]);
+    }
+}
+
+void BM_signLowLatencyBits(benchmark::State& state) {
+    const BitsKey &key = KeyOfBits((int)state.range(0));
+    SigningContext ctx(key.priv_arr[0], key.key_meta, key.pub);
+    for (auto _: state) {
+        ctx.SignLowLatency(doc[0]);
+    }
+}
+
+void BM_signWithPoolBits(benchmark::State& state) {
+    const BitsKey &key = KeyOfBits((int)state.range(0));
+    SigningContext ctx(key.priv_arr[0], key.key_meta, key.pub);
+    safeheron::tss_rsa::ProofCommitmentPool pool(key.key_meta, key.pub, 4, 1);
+    safeheron::tss_rsa::ProofCommitmentPoolStat stat;
+    pool.Start();
+    for (auto _: state) {
+        // Only time the online part: wait, untimed, until the pool is full again.
+        state.PauseTiming();
+        for (pool.GetStat(stat); stat.size < stat.capacity; pool.GetStat(stat)) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        state.ResumeTiming();
+        ctx.Sign(doc[0], pool);
+    }
+    pool.Stop();
+    pool.GetStat(stat);
+    state.counters["online_mean_us"] = stat.online_mean_us;
+    state.counters["online_max_us"] = stat.online_max_us;
+    state.counters["miss_num"] = (double)stat.miss_num;
+}
+
+void BM_verifySigShareBits(benchmark::State& state) {
+    // state.range(1) == 0 to verify without fixed-base tables
+    const BitsKey &key = KeyOfBits((int)state.range(0));
+    RSAKeyMeta t_key_meta = key.key_meta;
+    if (state.range(1) > 0) t_key_meta.BuildFixedBaseTables(key.pub.n(), (int)state.range(1));
+    std::vector<RSASigShare> share_arr = {SigningContext(key.priv_arr[0], key.key_meta, key.pub).Sign(doc[0])};
+    Combiner combiner(key.pub, t_key_meta);
+    for (auto _: state) {
+        std::vector<size_t> invalid_arr;
+        combiner.VerifySigShares(doc[0], share_arr, invalid_arr);
+    }
+    state.counters["table_bytes"] = (double)t_key_meta.FixedBaseTableMemorySize();
+}
+
 void BM_combineSig(benchmark::State& state) {
     for (auto _ : state) {
         for(size_t i = 0; i < sig_arr.size(); i++) {
@@ -84,6 +259,95 @@ void BM_combineSig(benchmark::State& state) {
     }
 }
 
+void BM_combineSigWithCombiner(benchmark::State& state) {
+    // The combiners are built once per key, outside of the timed loop.
+    std::vector<Combiner> combiner_arr;
+    for(size_t i = 0; i < sig_arr.size(); i++) {
+        combiner_arr.emplace_back(pub[i], key_meta[i]);
+    }
+    for (auto _ : state) {
+        for(size_t i = 0; i < sig_arr.size(); i++) {
+            combiner_arr[i].CombineSignaturesWithoutValidation(doc[i], sig_arr[i], sig[i]);
+        }
+    }
+}
+
+void BM_combineSigBatch(benchmark::State& state) {
+    // Each combiner combines 10 copies of its document in one call, on state.range(0) threads.
+    std::vector<Combiner> combiner_arr;
+    for(size_t i = 0; i < sig_arr.size(); i++) {
+        combiner_arr.emplace_back(pub[i], key_meta[i]);
+    }
+    for (auto _ : state) {
+        for(size_t i = 0; i < sig_arr.size(); i++) {
+            std::vector<std::string> doc_arr(10, doc[i]);
+            std::vector<std::vector<RSASigShare>> sig_arr_arr(10, sig_arr[i]);
+            std::vector<BN> out_sig_arr;
+            std::vector<size_t> failed_arr;
+            combiner_arr[i].CombineSignaturesBatch(doc_arr, sig_arr_arr, (int)state.range(0), out_sig_arr, failed_arr);
+        }
+    }
+}
+
+void BM_combineSigOptimistic(benchmark::State& state) {
+    // state.range(0): 0 for "CombineSignatures", 1 for "CombineSignaturesOptimistic", both with prepared combiners.
+    std::vector<Combiner> combiner_arr;
+    for(size_t i = 0; i < sig_arr.size(); i++) {
+        combiner_arr.emplace_back(pub[i], key_meta[i]);
+    }
+    for (auto _ : state) {
+        for(size_t i = 0; i < sig_arr.size(); i++) {
+            if (state.range(0) == 0) {
+                combiner_arr[i].CombineSignatures(doc[i], sig_arr[i], sig[i]);
+            } else {
+                std::vector<size_t> invalid_arr;
+                combiner_arr[i].CombineSignaturesOptimistic(doc[i], sig_arr[i], sig[i], invalid_arr);
+            }
+        }
+    }
+}
+
+void BM_combineSigMinimalCost(benchmark::State& state) {
+    // state.range(0): 0 for "CombineSignatures" on the l shares, 1 for "CombineSignaturesWithMinimalCost" on k of them.
+    std::vector<Combiner> combiner_arr;
+    for(size_t i = 0; i < sig_arr.size(); i++) {
+        combiner_arr.emplace_back(pub[i], key_meta[i]);
+    }
+    for (auto _ : state) {
+        for(size_t i = 0; i < sig_arr.size(); i++) {
+            if (state.range(0) == 0) {
+                combiner_arr[i].CombineSignatures(doc[i], sig_arr[i], sig[i]);
+            } else {
+                std::vector<size_t> used_arr;
+                combiner_arr[i].CombineSignaturesWithMinimalCost(doc[i], sig_arr[i], sig[i], used_arr);
+            }
+        }
+    }
+}
+
+void BM_combineSession(benchmark::State& state) {
+    // Latency from the arrival of the k-th share to the signature, for the first key.
+    // state.range(0): 0 for "Combiner::CombineSignatures" once all the shares are there, 1 for "CombineSession::AddShare".
+    Combiner combiner(pub[0], key_meta[0]);
+    int k = key_meta[0].k();
+    std::vector<RSASigShare> t_sig_arr(sig_arr[0].begin(), sig_arr[0].begin() + k);
+    std::vector<int> index_arr;
+    for (const auto &sig_share : t_sig_arr) index_arr.push_back(sig_share.index());
+    BN t_sig;
+    for (auto _ : state) {
+        if (state.range(0) == 0) {
+            combiner.CombineSignatures(doc[0], t_sig_arr, t_sig);
+        } else {
+            state.PauseTiming();
+            safeheron::tss_rsa::CombineSession session(combiner, doc[0], index_arr);
+            for (int i = 0; i < k - 1; i++) session.AddShare(t_sig_arr[i]);
+            state.ResumeTiming();
+            session.AddShare(t_sig_arr[k - 1]);
+            session.GetSignature(t_sig);
+        }
+    }
+}
+
 void BM_verifySig(benchmark::State& state) {
     for (auto _ : state) {
         for(size_t i = 0; i < sig.size(); i++) {
@@ -95,17 +359,247 @@ void BM_verifySig(benchmark::State& state) {
     }
 }
 
+void BM_verifySigBatch(benchmark::State& state) {
+    // Each key verifies 10 copies of its signature in one call.
+    for (auto _: state) {
+        for(size_t i = 0; i < sig.size(); i++) {
+            std::vector<std::string> doc_arr(10, doc[i]);
+            std::vector<BN> sig_batch(10, sig[i]);
+            std::vector<size_t> invalid_arr;
+            pub[i].VerifySignatureBatch(doc_arr, sig_batch, invalid_arr);
+        }
+    }
+}
+
+void BM_verifySigSharesOneByOne(benchmark::State& state) {
+    std::vector<Combiner> combiner_arr;
+    for(size_t i = 0; i < sig_arr.size(); i++) {
+        combiner_arr.emplace_back(pub[i], key_meta[i]);
+    }
+    for (auto _ : state) {
+        for(size_t i = 0; i < sig_arr.size(); i++) {
+            for(const auto &sig_share : sig_arr[i]) {
+                std::vector<size_t> invalid_arr;
+                combiner_arr[i].VerifySigShares(doc[i], {sig_share}, invalid_arr);
+            }
+        }
+    }
+}
+
+void BM_verifySigShares(benchmark::State& state) {
+    std::vector<Combiner> combiner_arr;
+    for(size_t i = 0; i < sig_arr.size(); i++) {
+        combiner_arr.emplace_back(pub[i], key_meta[i]);
+    }
+    for (auto _ : state) {
+        for(size_t i = 0; i < sig_arr.size(); i++) {
+            std::vector<size_t> invalid_arr;
+            combiner_arr[i].VerifySigShares(doc[i], sig_arr[i], invalid_arr);
+        }
+    }
+    for(size_t i = 0; i < sig_arr.size(); i++) {
+        std::vector<size_t> invalid_arr;
+        EXPECT_TRUE(combiner_arr[i].VerifySigShares(doc[i], sig_arr[i], invalid_arr));
+    }
+}
+
+/**
+ * Inputs of the combination step with k shares under a 4096-bit modulus.
+ */
+struct CombineInput {
+    BN n;
+    BN x;
+    BN a;
+    BN b;
+    std::vector<BN> sig_share_arr;
+    std::vector<BN> exp_arr;  // 2 * \lambda_{0,i}^S
+};
+
+static CombineInput PrepareCombineInput(int k) {
+    static BN n = safeheron::rand::RandomPrime(2048) * safeheron::rand::RandomPrime(2048);
+    CombineInput input;
+    input.n = n;
+    input.x = safeheron::rand::RandomBNLtCoPrime(n);
+    BN d;
+    BN::ExtendedEuclidean(BN(4), BN(65537), input.a, input.b, d);
+    BN delta(1);
+    std::vector<BN> S;
+    for (int i = 1; i <= k; i++) {
+        delta *= i;
+        S.emplace_back(BN(i));
+    }
+    for (int i = 1; i <= k; i++) {
+        input.sig_share_arr.push_back(safeheron::rand::RandomBNLtCoPrime(n));
+        input.exp_arr.push_back(safeheron::tss_rsa::lambda(BN(0), BN(i), S, delta) * 2);
+    }
+    return input;
+}
+
+void BM_combineLoop(benchmark::State& state) {
+    CombineInput input = PrepareCombineInput((int)state.range(0));
+    for (auto _ : state) {
+        // w = x_{i_1}^{2 \lambda_{0,i_1}^S} \dots	x_{i_k}^{2 \lambda_{0,i_k}^S} \pmod n
+        BN w(1);
+        for (size_t i = 0; i < input.sig_share_arr.size(); i++) {
+            w = (w * input.sig_share_arr[i].PowM(input.exp_arr[i], input.n)) % input.n;
+        }
+        // y = w^a x^b \pmod n
+        BN y = w.PowM(input.a, input.n) * input.x.PowM(input.b, input.n) % input.n;
+        benchmark::DoNotOptimize(y);
+    }
+}
+
+void BM_combineMultiPowM(benchmark::State& state) {
+    CombineInput input = PrepareCombineInput((int)state.range(0));
+    MontContext mont_n(input.n);
+    for (auto _ : state) {
+        // y = x_{i_1}^{2a \lambda_{0,i_1}^S} \dots x_{i_k}^{2a \lambda_{0,i_k}^S} x^b \pmod n
+        std::vector<BN> base_arr = input.sig_share_arr;
+        std::vector<BN> power_arr;
+        for (const auto &item : input.exp_arr) {
+            power_arr.push_back(item * input.a);
+        }
+        base_arr.push_back(input.x);
+        power_arr.push_back(input.b);
+        BN y = mont_n.MultiPowM(base_arr, power_arr);
+        benchmark::DoNotOptimize(y);
+    }
+}
+
+void BM_encodePSS(benchmark::State& state) {
+    int key_bits = (int)state.range(0);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(safeheron::tss_rsa::EncodeEMSA_PSS(doc[0], key_bits, safeheron::tss_rsa::SaltLength::AutoLength));
+    }
+}
+
+void BM_encodePSSIntoBuffer(benchmark::State& state) {
+    int key_bits = (int)state.range(0);
+    std::vector<uint8_t> em(safeheron::tss_rsa::EMSA_PSSLength(key_bits));
+    for (auto _ : state) {
+        safeheron::tss_rsa::EncodeEMSA_PSS((const uint8_t *)doc[0].c_str(), doc[0].size(), key_bits,
+                                           safeheron::tss_rsa::SaltLength::AutoLength, em.data(), em.size());
+        benchmark::DoNotOptimize(em.data());
+    }
+}
+
+void BM_encodePSSWithHash(benchmark::State& state) {
+    // state.range(0): index of the hash function, state.range(1): bit length of the key
+    safeheron::tss_rsa::HashAlgorithm hash = (safeheron::tss_rsa::HashAlgorithm)state.range(0);
+    int key_bits = (int)state.range(1);
+    std::string message(1 << 20, 'a');
+    std::vector<uint8_t> em(safeheron::tss_rsa::EMSA_PSSLength(key_bits));
+    for (auto _ : state) {
+        safeheron::tss_rsa::EncodeEMSA_PSS((const uint8_t *)message.c_str(), message.size(), key_bits,
+                                           safeheron::tss_rsa::SaltLength::EqualToHash, hash, em.data(), em.size());
+        benchmark::DoNotOptimize(em.data());
+    }
+    state.SetBytesProcessed((int64_t)state.iterations() * (int64_t)message.size());
+}
+
+void BM_serializeSigShare(benchmark::State& state) {
+    // state.range(0): 0 for the base64 format, 1 for the binary format; state.range(1): bit length of the key
+    int key_bits = (int)state.range(1);
+    BN n = safeheron::rand::RandomBNStrict(key_bits);
+    BN z = safeheron::rand::RandomBNStrict(key_bits + 2 * 256 + 1);
+    BN c = safeheron::rand::RandomBNStrict(256);
+    RSASigShare sig_share(1, n, z, c);
+    RSASigShare restored;
+    std::string str;
+    for (auto _ : state) {
+        if (state.range(0) == 0) {
+            sig_share.ToBase64(str);
+            restored.FromBase64(str);
+        } else {
+            sig_share.ToBytes(str);
+            restored.FromBytes(str);
+        }
+        benchmark::DoNotOptimize(restored);
+    }
+    state.counters["bytes"] = (double)str.size();
+}
+
+void BM_loadKeyMeta(benchmark::State& state) {
+    // state.range(0): 0 for "FromBase64", 1 for "FromBytes", 2 for "RSAKeyMetaView"; state.range(1): l
+    // The key meta data of a 4096-bit key is loaded, then the validation keys of k = l/2 + 1 signers are read.
+    int l = (int)state.range(1);
+    int k = l / 2 + 1;
+    std::vector<BN> vki_arr;
+    for (int i = 0; i < l; i++) {
+        vki_arr.push_back(safeheron::rand::RandomBNStrict(4096));
+    }
+    RSAKeyMeta t_key_meta(k, l, safeheron::rand::RandomBNStrict(4096), vki_arr, safeheron::rand::RandomBNStrict(4096));
+    std::string b64, bytes;
+    t_key_meta.ToBase64(b64);
+    t_key_meta.ToBytes(bytes);
+    for (auto _ : state) {
+        if (state.range(0) == 2) {
+            safeheron::tss_rsa::RSAKeyMetaView view;
+            view.Load(bytes);
+            for (int i = 0; i < k; i++) benchmark::DoNotOptimize(view.vki(i));
+        } else {
+            RSAKeyMeta restored;
+            if (state.range(0) == 0) restored.FromBase64(b64);
+            else restored.FromBytes(bytes);
+            for (int i = 0; i < k; i++) benchmark::DoNotOptimize(restored.vki(i));
+        }
+    }
+}
+
 int main(int argc, char** argv) {
     benchmark::Initialize(&argc, argv);
     int n_key_pairs = 10;
     // Generate "n_key_pairs" key pairs: n_key_pairs = 10
     ::benchmark::RegisterBenchmark("BM_generateRandom", &BM_generateRandom, 4096, 5, 3)->Iterations(n_key_pairs)->Unit(benchmark::kSecond);
+    // Generate key pairs with 1, 4, 16 and 32 threads searching the safe primes
+    ::benchmark::RegisterBenchmark("BM_generateParallel", &BM_generateParallel, 4096, 5, 3)->Arg(1)->Arg(4)->Arg(16)->Arg(32)->Iterations(n_key_pairs)->Unit(benchmark::kSecond);
+    // Generate 1024/1536/2048-bit safe primes: RandomSafePrime vs the sieve of tss-rsa
+    ::benchmark::RegisterBenchmark("BM_randomSafePrime", &BM_randomSafePrime)->Arg(1024)->Arg(1536)->Arg(2048)->Iterations(10)->Unit(benchmark::kSecond);
+    ::benchmark::RegisterBenchmark("BM_generateSafePrime", &BM_generateSafePrime)->Arg(1024)->Arg(1536)->Arg(2048)->Iterations(10)->Unit(benchmark::kSecond);
     // Generate 10 * "n_key_pairs" signature shares
     ::benchmark::RegisterBenchmark("BM_generateSig", &BM_generateSig)->Iterations(10)->Unit(benchmark::kSecond);
+    // Generate 10 * "n_key_pairs" signature shares with prepared signing contexts
+    ::benchmark::RegisterBenchmark("BM_generateSigWithContext", &BM_generateSigWithContext)->Iterations(10)->Unit(benchmark::kSecond);
+    // Generate 10 * "n_key_pairs" signature shares, each party signs the 10 documents in one call with 1 and 4 threads
+    ::benchmark::RegisterBenchmark("BM_generateSigBatch", &BM_generateSigBatch)->Arg(1)->Arg(4)->Iterations(10)->Unit(benchmark::kSecond);
+    // Generate one signature share under a 2048/3072/4096-bit key: "Sign" vs "SignLowLatency"
+    ::benchmark::RegisterBenchmark("BM_signBits", &BM_signBits)->Arg(2048)->Arg(3072)->Arg(4096)->Iterations(20)->UseRealTime()->Unit(benchmark::kMillisecond);
+    ::benchmark::RegisterBenchmark("BM_signLowLatencyBits", &BM_signLowLatencyBits)->Arg(2048)->Arg(3072)->Arg(4096)->Iterations(20)->UseRealTime()->Unit(benchmark::kMillisecond);
+    // Generate one signature share under a 2048/3072/4096-bit key, with r and v^r from a pool filled offline
+    ::benchmark::RegisterBenchmark("BM_signWithPoolBits", &BM_signWithPoolBits)->Arg(2048)->Arg(3072)->Arg(4096)->Iterations(20)->UseRealTime()->Unit(benchmark::kMillisecond);
+    // Verify one signature share under a 2048/3072/4096-bit key, without tables and with tables of 2^4/2^6/2^8 entries
+    ::benchmark::RegisterBenchmark("BM_verifySigShareBits", &BM_verifySigShareBits)->ArgsProduct({{2048, 3072, 4096}, {0, 4, 6, 8}})->Iterations(20)->Unit(benchmark::kMillisecond);
     // Combine 10 * "n_key_pairs" signatures
     ::benchmark::RegisterBenchmark("BM_combineSig", &BM_combineSig)->Iterations(10)->Unit(benchmark::kSecond);
+    // Combine 10 * "n_key_pairs" signatures with prepared combiners
+    ::benchmark::RegisterBenchmark("BM_combineSigWithCombiner", &BM_combineSigWithCombiner)->Iterations(10)->Unit(benchmark::kSecond);
+    // Combine and validate 10 * 10 * "n_key_pairs" signatures in batches of 10 documents, with 1 and 4 threads
+    ::benchmark::RegisterBenchmark("BM_combineSigBatch", &BM_combineSigBatch)->Arg(1)->Arg(4)->Iterations(10)->Unit(benchmark::kSecond);
+    // Combine 10 * "n_key_pairs" signatures with prepared combiners: validating every share vs optimistic
+    ::benchmark::RegisterBenchmark("BM_combineSigOptimistic", &BM_combineSigOptimistic)->Arg(0)->Arg(1)->Iterations(10)->Unit(benchmark::kMillisecond);
+    // Combine 10 * "n_key_pairs" signatures from the l = 5 shares with prepared combiners: all of them vs the cheapest k = 3
+    ::benchmark::RegisterBenchmark("BM_combineSigMinimalCost", &BM_combineSigMinimalCost)->Arg(0)->Arg(1)->Iterations(10)->Unit(benchmark::kMillisecond);
+    // Latency of combining after the k-th share arrives: all at once vs incrementally in a session
+    ::benchmark::RegisterBenchmark("BM_combineSession", &BM_combineSession)->Arg(0)->Arg(1)->Iterations(10)->Unit(benchmark::kMillisecond);
     // Verify 10 * "n_key_pairs" signatures
     ::benchmark::RegisterBenchmark("BM_verifySig", &BM_verifySig)->Iterations(10)->Unit(benchmark::kSecond);
+    // Verify 10 * 10 * "n_key_pairs" signatures in batches of 10
+    ::benchmark::RegisterBenchmark("BM_verifySigBatch", &BM_verifySigBatch)->Iterations(10)->Unit(benchmark::kSecond);
+    // Verify the proofs of 5 * "n_key_pairs" signature shares: one by one vs batched per document
+    ::benchmark::RegisterBenchmark("BM_verifySigSharesOneByOne", &BM_verifySigSharesOneByOne)->Iterations(10)->Unit(benchmark::kSecond);
+    ::benchmark::RegisterBenchmark("BM_verifySigShares", &BM_verifySigShares)->Iterations(10)->Unit(benchmark::kSecond);
+    // Combine k = 3..7 shares under a 4096-bit modulus: separate exponentiations vs one multi-exponentiation
+    ::benchmark::RegisterBenchmark("BM_combineLoop", &BM_combineLoop)->DenseRange(3, 7)->Unit(benchmark::kMicrosecond);
+    ::benchmark::RegisterBenchmark("BM_combineMultiPowM", &BM_combineMultiPowM)->DenseRange(3, 7)->Unit(benchmark::kMicrosecond);
+    // EMSA-PSS encoding for a 2048/4096-bit key: into a new string vs into a buffer of the caller
+    ::benchmark::RegisterBenchmark("BM_encodePSS", &BM_encodePSS)->Arg(2048)->Arg(4096)->Unit(benchmark::kMicrosecond);
+    ::benchmark::RegisterBenchmark("BM_encodePSSIntoBuffer", &BM_encodePSSIntoBuffer)->Arg(2048)->Arg(4096)->Unit(benchmark::kMicrosecond);
+    // EMSA-PSS encoding of a 1 MiB message for a 3072/4096-bit key, with SHA256, SHA384, SHA512, SHA3-256, SHA3-384 and SHA3-512
+    ::benchmark::RegisterBenchmark("BM_encodePSSWithHash", &BM_encodePSSWithHash)->ArgsProduct({{0, 1, 2, 3, 4, 5}, {3072, 4096}})->Unit(benchmark::kMicrosecond);
+    // Serialize and parse a signature share under a 2048/4096-bit key: base64 vs binary format
+    ::benchmark::RegisterBenchmark("BM_serializeSigShare", &BM_serializeSigShare)->ArgsProduct({{0, 1}, {2048, 4096}})->Unit(benchmark::kMicrosecond);
+    // Load the key meta data of a 4096-bit key with l = 10/40 parties: base64 vs binary format vs lazy view
+    ::benchmark::RegisterBenchmark("BM_loadKeyMeta", &BM_loadKeyMeta)->ArgsProduct({{0, 1, 2}, {10, 40}})->Unit(benchmark::kMicrosecond);
     benchmark::RunSpecifiedBenchmarks();
     benchmark::Shutdown();
     return 0;
@@ -1,3 +1,5 @@
+#include <cstdio>
+#include <fstream>
 #include "gtest/gtest.h"
 #include "crypto-bn/bn.h"
 #include "crypto-bn/rand.h"
@@ -5,6 +7,7 @@
 #include "../src/crypto-tss-rsa/tss_rsa.h"
 #include "../src/crypto-tss-rsa/emsa_pss.h"
 #include "crypto-encode/hex.h"
+#include "crypto-hash/sha256.h"
 using safeheron::bignum::BN;
 using safeheron::tss_rsa::RSAPrivateKeyShare;
 using safeheron::tss_rsa::RSAPublicKey;
@@ -100,3 +103,200 @@ int main(int argc, char **argv) {
     int ret = RUN_ALL_TESTS();
     return ret;
 }
+
+TEST(TSS_RSA, PSS_Streaming) {
+    int key_bits_length = 2048;
+    std::string doc;
+    for(int i = 0; i < 100000; i++) doc.append(1, (char)(i * 7));
+    const uint8_t *data = reinterpret_cast<const uint8_t *>(doc.c_str());
+
+    // Encode in pieces, verify in one call.
+    safeheron::tss_rsa::PssEncoder encoder(safeheron::tss_rsa::SaltLength::AutoLength);
+    for(size_t pos = 0; pos < doc.size(); pos += 4093) {
+        encoder.Update(data + pos, std::min<size_t>(4093, doc.size() - pos));
+    }
+    std::string doc_pss = encoder.Finalize(key_bits_length);
+    EXPECT_TRUE(safeheron::tss_rsa::VerifyEMSA_PSS(doc, key_bits_length, safeheron::tss_rsa::SaltLength::AutoLength, doc_pss));
+    EXPECT_FALSE(safeheron::tss_rsa::VerifyEMSA_PSS(doc + "x", key_bits_length, safeheron::tss_rsa::SaltLength::AutoLength, doc_pss));
+
+    // Encode in one call, verify in pieces.
+    doc_pss = safeheron::tss_rsa::EncodeEMSA_PSS(doc, key_bits_length, safeheron::tss_rsa::SaltLength::EqualToHash);
+    safeheron::tss_rsa::PssVerifier verifier(safeheron::tss_rsa::SaltLength::EqualToHash);
+    verifier.Update(data, 10);
+    verifier.Update(data + 10, doc.size() - 10);
+    EXPECT_TRUE(verifier.Finalize(key_bits_length, doc_pss));
+    // The verifier is reset by "Finalize".
+    verifier.Update(data, 10);
+    EXPECT_FALSE(verifier.Finalize(key_bits_length, doc_pss));
+
+    // Encode and verify a file.
+    std::string path = "pss_streaming_test.bin";
+    {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        for(int i = 0; i < 30; i++) out.write(doc.data(), (std::streamsize)doc.size());
+    }
+    std::string big_doc;
+    for(int i = 0; i < 30; i++) big_doc.append(doc);
+    EXPECT_TRUE(encoder.UpdateFromFile(path));
+    doc_pss = encoder.Finalize(key_bits_length);
+    EXPECT_TRUE(safeheron::tss_rsa::VerifyEMSA_PSS(big_doc, key_bits_length, safeheron::tss_rsa::SaltLength::AutoLength, doc_pss));
+    EXPECT_TRUE(verifier.UpdateFromFile(path));
+    EXPECT_FALSE(verifier.Finalize(key_bits_length, doc_pss));
+    safeheron::tss_rsa::PssVerifier auto_verifier(safeheron::tss_rsa::SaltLength::AutoLength);
+    EXPECT_TRUE(auto_verifier.UpdateFromFile(path));
+    EXPECT_TRUE(auto_verifier.Finalize(key_bits_length, doc_pss));
+    std::remove(path.c_str());
+    EXPECT_FALSE(encoder.UpdateFromFile(path));
+}
+
+TEST(TSS_RSA, PSS_FromDigest) {
+    int key_bits_length = 2048;
+    std::string doc = "hello world";
+    uint8_t digest[safeheron::hash::CSHA256::OUTPUT_SIZE];
+    safeheron::hash::CSHA256 sha256;
+    sha256.Write(reinterpret_cast<const uint8_t *>(doc.c_str()), doc.length());
+    sha256.Finalize(digest);
+    std::string mHash(reinterpret_cast<const char *>(digest), safeheron::hash::CSHA256::OUTPUT_SIZE);
+
+    // The encoding from the digest is an encoding of the message.
+    std::string doc_pss = safeheron::tss_rsa::EncodeEMSA_PSSFromDigest(mHash, key_bits_length, safeheron::tss_rsa::SaltLength::AutoLength);
+    EXPECT_TRUE(safeheron::tss_rsa::VerifyEMSA_PSS(doc, key_bits_length, safeheron::tss_rsa::SaltLength::AutoLength, doc_pss));
+    EXPECT_TRUE(safeheron::tss_rsa::VerifyEMSA_PSSFromDigest(mHash, key_bits_length, safeheron::tss_rsa::SaltLength::AutoLength, doc_pss));
+
+    doc_pss = safeheron::tss_rsa::EncodeEMSA_PSS(doc, key_bits_length, safeheron::tss_rsa::SaltLength::EqualToHash);
+    EXPECT_TRUE(safeheron::tss_rsa::VerifyEMSA_PSSFromDigest(mHash, key_bits_length, safeheron::tss_rsa::SaltLength::EqualToHash, doc_pss));
+    EXPECT_FALSE(safeheron::tss_rsa::VerifyEMSA_PSSFromDigest(mHash, key_bits_length, safeheron::tss_rsa::SaltLength::AutoLength, doc_pss));
+
+    // Tampered encodings and digests are rejected.
+    std::string bad_pss = doc_pss;
+    bad_pss[10] ^= 0x01;
+    EXPECT_FALSE(safeheron::tss_rsa::VerifyEMSA_PSSFromDigest(mHash, key_bits_length, safeheron::tss_rsa::SaltLength::EqualToHash, bad_pss));
+    std::string bad_hash = mHash;
+    bad_hash[0] ^= 0x01;
+    EXPECT_FALSE(safeheron::tss_rsa::VerifyEMSA_PSSFromDigest(bad_hash, key_bits_length, safeheron::tss_rsa::SaltLength::EqualToHash, doc_pss));
+    EXPECT_FALSE(safeheron::tss_rsa::VerifyEMSA_PSSFromDigest(mHash.substr(1), key_bits_length, safeheron::tss_rsa::SaltLength::EqualToHash, doc_pss));
+    EXPECT_THROW(safeheron::tss_rsa::EncodeEMSA_PSSFromDigest(mHash.substr(1), key_bits_length, safeheron::tss_rsa::SaltLength::EqualToHash), LocatedException);
+}
+
+TEST(TSS_RSA, PSS_IntoBuffer) {
+    std::string doc = "hello world";
+    for(int key_bits_length : {1024, 2047, 4096}) {
+        size_t em_len = safeheron::tss_rsa::EMSA_PSSLength(key_bits_length);
+        EXPECT_EQ(em_len, (size_t)(key_bits_length + 6) / 8);
+
+        // The encoding into a buffer verifies like the one into a string.
+        std::string em(em_len, '\0');
+        safeheron::tss_rsa::EncodeEMSA_PSS(reinterpret_cast<const uint8_t *>(doc.c_str()), doc.size(), key_bits_length,
+                                           safeheron::tss_rsa::SaltLength::AutoLength, reinterpret_cast<uint8_t *>(&em[0]), em.size());
+        EXPECT_TRUE(safeheron::tss_rsa::VerifyEMSA_PSS(doc, key_bits_length, safeheron::tss_rsa::SaltLength::AutoLength, em));
+        EXPECT_THROW(safeheron::tss_rsa::EncodeEMSA_PSS(reinterpret_cast<const uint8_t *>(doc.c_str()), doc.size(), key_bits_length,
+                                                        safeheron::tss_rsa::SaltLength::AutoLength, reinterpret_cast<uint8_t *>(&em[0]), em.size() - 1), LocatedException);
+    }
+
+    // MGF1 into a buffer is the prefix of a longer mask, as in the string version.
+    uint8_t seed[] = {1, 2, 3};
+    std::string mask = safeheron::tss_rsa::MGF1(seed, sizeof(seed), 100);
+    uint8_t buf[77];
+    safeheron::tss_rsa::MGF1(seed, sizeof(seed), buf, sizeof(buf));
+    EXPECT_EQ(mask.substr(0, sizeof(buf)), std::string(reinterpret_cast<const char *>(buf), sizeof(buf)));
+    EXPECT_EQ(safeheron::tss_rsa::MGF1(seed, sizeof(seed), 0), "");
+}
+
+TEST(TSS_RSA, PSS_HashAlgorithm) {
+    using safeheron::tss_rsa::HashAlgorithm;
+    using safeheron::tss_rsa::SaltLength;
+    std::string doc = "hello world";
+    int key_bits_length = 3072;
+    HashAlgorithm hash_arr[] = {HashAlgorithm::SHA256, HashAlgorithm::SHA384, HashAlgorithm::SHA512,
+                                HashAlgorithm::SHA3_256, HashAlgorithm::SHA3_384, HashAlgorithm::SHA3_512};
+    size_t size_arr[] = {32, 48, 64, 32, 48, 64};
+    for(size_t i = 0; i < 6; i++) {
+        HashAlgorithm hash = hash_arr[i];
+        EXPECT_EQ(safeheron::tss_rsa::HashOutputSize(hash), size_arr[i]);
+        for(SaltLength salt_length : {SaltLength::AutoLength, SaltLength::EqualToHash}) {
+            std::string doc_pss = safeheron::tss_rsa::EncodeEMSA_PSS(doc, key_bits_length, salt_length, hash);
+            EXPECT_TRUE(safeheron::tss_rsa::VerifyEMSA_PSS(doc, key_bits_length, salt_length, hash, doc_pss));
+            EXPECT_FALSE(safeheron::tss_rsa::VerifyEMSA_PSS(doc + "x", key_bits_length, salt_length, hash, doc_pss));
+            // An encoding is only consistent with its own hash function.
+            for(size_t j = 0; j < 6; j++) {
+                if(j == i) continue;
+                EXPECT_FALSE(safeheron::tss_rsa::VerifyEMSA_PSS(doc, key_bits_length, salt_length, hash_arr[j], doc_pss));
+            }
+        }
+
+        // The streaming verifier accepts the encoding.
+        std::string doc_pss = safeheron::tss_rsa::EncodeEMSA_PSS(doc, key_bits_length, SaltLength::EqualToHash, hash);
+        safeheron::tss_rsa::PssVerifier verifier(SaltLength::EqualToHash, hash);
+        verifier.Update(reinterpret_cast<const uint8_t *>(doc.c_str()), 5);
+        verifier.Update(reinterpret_cast<const uint8_t *>(doc.c_str()) + 5, doc.size() - 5);
+        EXPECT_TRUE(verifier.Finalize(key_bits_length, doc_pss));
+
+        // A digest of the wrong length is refused.
+        std::string bad_hash(size_arr[i] + 1, '\x01');
+        EXPECT_FALSE(safeheron::tss_rsa::VerifyEMSA_PSSFromDigest(bad_hash, key_bits_length, SaltLength::EqualToHash, hash, doc_pss));
+    }
+
+    // The SHA256 overloads are the ones without a hash function.
+    std::string doc_pss = safeheron::tss_rsa::EncodeEMSA_PSS(doc, key_bits_length, SaltLength::AutoLength, HashAlgorithm::SHA256);
+    EXPECT_TRUE(safeheron::tss_rsa::VerifyEMSA_PSS(doc, key_bits_length, SaltLength::AutoLength, doc_pss));
+    uint8_t seed[] = {1, 2, 3};
+    uint8_t buf[77];
+    safeheron::tss_rsa::MGF1(seed, sizeof(seed), HashAlgorithm::SHA256, buf, sizeof(buf));
+    EXPECT_EQ(safeheron::tss_rsa::MGF1(seed, sizeof(seed), sizeof(buf)), std::string(reinterpret_cast<const char *>(buf), sizeof(buf)));
+
+    // A 1024-bit key leaves no room for SHA-512 and a salt of 64 bytes.
+    EXPECT_THROW(safeheron::tss_rsa::EncodeEMSA_PSS(doc, 1024, SaltLength::EqualToHash, HashAlgorithm::SHA512), LocatedException);
+}
+
+TEST(TSS_RSA, PKCS1_v1_5_And_ZeroSalt) {
+    using safeheron::tss_rsa::HashAlgorithm;
+    using safeheron::tss_rsa::SaltLength;
+    std::string doc = "hello world";
+    int key_bits_length = 2048;
+
+    // Key Generation
+    int k = 2;
+    int l = 3;
+    std::vector<RSAPrivateKeyShare> priv_arr;
+    RSAPublicKey pub;
+    RSAKeyMeta key_meta;
+    EXPECT_TRUE(safeheron::tss_rsa::GenerateKey(key_bits_length, l, k, priv_arr, pub, key_meta));
+
+    // Each party derives the same encoding from the digest, without coordination.
+    std::string mHash = safeheron::tss_rsa::Digest(doc, HashAlgorithm::SHA256);
+    std::string em_arr[] = {safeheron::tss_rsa::EncodeEMSA_PKCS1_v1_5FromDigest(mHash, key_bits_length, HashAlgorithm::SHA256),
+                            safeheron::tss_rsa::EncodeEMSA_PKCS1_v1_5(doc, key_bits_length, HashAlgorithm::SHA256)};
+    EXPECT_EQ(em_arr[0], em_arr[1]);
+    // EM = 0x00 || 0x01 || 0xff ... 0xff || 0x00 || DigestInfo
+    std::string em = em_arr[0];
+    EXPECT_EQ(em.size(), 256);
+    EXPECT_EQ(em.substr(0, 2), std::string("\x00\x01", 2));
+    EXPECT_EQ(em.substr(2, 256 - 3 - 19 - 32), std::string(256 - 3 - 19 - 32, '\xff'));
+    EXPECT_EQ(safeheron::encode::hex::EncodeToHex(em.substr(256 - 32 - 19 - 1, 20)), "003031300d060960864801650304020105000420");
+    EXPECT_EQ(em.substr(256 - 32), mHash);
+    EXPECT_TRUE(safeheron::tss_rsa::VerifyEMSA_PKCS1_v1_5(doc, key_bits_length, HashAlgorithm::SHA256, em));
+    EXPECT_FALSE(safeheron::tss_rsa::VerifyEMSA_PKCS1_v1_5(doc, key_bits_length, HashAlgorithm::SHA3_256, em));
+    EXPECT_FALSE(safeheron::tss_rsa::VerifyEMSA_PKCS1_v1_5FromDigest(mHash.substr(1), key_bits_length, HashAlgorithm::SHA256, em));
+    for(HashAlgorithm hash : {HashAlgorithm::SHA384, HashAlgorithm::SHA512, HashAlgorithm::SHA3_512}) {
+        std::string em_h = safeheron::tss_rsa::EncodeEMSA_PKCS1_v1_5(doc, key_bits_length, hash);
+        EXPECT_TRUE(safeheron::tss_rsa::VerifyEMSA_PKCS1_v1_5(doc, key_bits_length, hash, em_h));
+        EXPECT_FALSE(safeheron::tss_rsa::VerifyEMSA_PKCS1_v1_5(doc + "x", key_bits_length, hash, em_h));
+    }
+
+    // Sign and verify the PKCS#1 v1.5 encoding.
+    std::vector<RSASigShare> sig_arr;
+    sig_arr.push_back(priv_arr[0].Sign(em, key_meta, pub));
+    sig_arr.push_back(priv_arr[2].Sign(em, key_meta, pub));
+    BN sig;
+    EXPECT_TRUE(safeheron::tss_rsa::CombineSignatures(em, sig_arr, pub, key_meta, sig));
+    EXPECT_TRUE(pub.VerifySignature(em, sig));
+
+    // PSS without salt is deterministic too.
+    std::string pss0 = safeheron::tss_rsa::EncodeEMSA_PSSFromDigest(mHash, key_bits_length, SaltLength::ZeroLength);
+    std::string pss1 = safeheron::tss_rsa::EncodeEMSA_PSS(doc, key_bits_length, SaltLength::ZeroLength);
+    EXPECT_EQ(pss0, pss1);
+    EXPECT_TRUE(safeheron::tss_rsa::VerifyEMSA_PSS(doc, key_bits_length, SaltLength::ZeroLength, pss0));
+    EXPECT_FALSE(safeheron::tss_rsa::VerifyEMSA_PSS(doc, key_bits_length, SaltLength::EqualToHash, pss0));
+    EXPECT_FALSE(safeheron::tss_rsa::VerifyEMSA_PSS(doc, key_bits_length, SaltLength::ZeroLength,
+                                                    safeheron::tss_rsa::EncodeEMSA_PSS(doc, key_bits_length, SaltLength::EqualToHash)));
+}